@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Base.h"
+
+/* Object -> BenchA -> BenchB -> BenchC */
+
+#define BENCH_A_TYPE (bench_a_get_type())
+DECLARE_DERIVABLE_TYPE(BenchA, bench_a, BENCH_A, Object);
+
+struct _BenchA { Object parent; int a; };
+struct _BenchAClass { ObjectClass parent; };
+
+#define BENCH_B_TYPE (bench_b_get_type())
+DECLARE_DERIVABLE_TYPE(BenchB, bench_b, BENCH_B, BenchA);
+
+struct _BenchB { BenchA parent; int b; };
+struct _BenchBClass { BenchAClass parent; };
+
+#define BENCH_C_TYPE (bench_c_get_type())
+DECLARE_TYPE(BenchC, bench_c, BENCH_C, BenchB);
+
+struct _BenchC { BenchB parent; int c; };
+
+#define BENCH_D_TYPE (bench_d_get_type())
+DECLARE_TYPE(BenchD, bench_d, BENCH_D, BenchA);
+
+struct _BenchD { BenchA parent; int d; };
+
+DEFINE_TYPE(BenchA, bench_a, object);
+DEFINE_TYPE(BenchB, bench_b, bench_a);
+DEFINE_TYPE(BenchC, bench_c, bench_b);
+DEFINE_TYPE(BenchD, bench_d, bench_a);
+
+static void bench_a_class_init(BenchAClass *klass) {}
+static void bench_b_class_init(BenchBClass *klass) {}
+static void bench_c_class_init(BenchCClass *klass) {}
+static void bench_d_class_init(BenchDClass *klass) {}
+
+#define ITERATIONS 50000000
+
+int main(int argc, char *argv[])
+{
+	size_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : ITERATIONS;
+
+	Object *objs[2] = {
+		object_new(BENCH_C_TYPE),
+		object_new(BENCH_D_TYPE)
+	};
+
+	/* The objects are taken through a volatile index, so the checks aren't hoisted */
+	volatile size_t which = 0;
+	size_t hits = 0;
+
+	clock_t start = clock();
+
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		const Object *obj = objs[which];
+
+		hits += IS_OBJECT(obj);
+		hits += IS_BENCH_A((const BenchA*) obj);
+		hits += IS_BENCH_B((const BenchB*) obj);
+		hits += IS_BENCH_D((const BenchD*) obj); // The miss
+	}
+
+	clock_t end = clock();
+
+	double seconds = (double) (end - start) / CLOCKS_PER_SEC;
+
+	printf("IS_* on Object -> BenchA -> BenchB -> BenchC, 4 checks per iteration (1 miss)\n");
+	printf("%lu iterations: %lf seconds, %.2lf ns per check (hits: %lu)\n",
+			iterations, seconds, seconds * 1e9 / (4.0 * iterations), hits);
+
+	object_delete(objs[0]);
+	object_delete(objs[1]);
+
+	return 0;
+}
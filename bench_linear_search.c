@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "Base.h"
+#include "DataStructs/Array.h"
+
+/* Miss scans of an Array of {int key; int value}: cmp_func against every kernel of the typed scan */
+
+#define ELEMENTS_PER_CELL 67108864
+
+typedef struct _TestArray
+{
+	int key;
+	int value;
+} TestArray;
+
+static const size_t lengths[] = { 16, 256, 4096, 65536, 1048576 };
+
+static const char *isa_names[] = {
+	"auto",
+	"scalar",
+	"SSE2",
+	"AVX2"
+};
+
+int test_array_cmp(const void *a, const void *b)
+{
+	const TestArray *ia = a;
+	const TestArray *ib = b;
+
+	return ia->key - ib->key;
+}
+
+/* ns per element, cmp_func == NULL takes the typed scan */
+double scan(const Array *arr, size_t len, CmpFunc cmp_func, size_t elements)
+{
+	size_t repeats = (elements + len - 1) / len;
+	size_t found = 0;
+
+	clock_t start = clock();
+
+	for (size_t r = 0; r < repeats; ++r)
+	{
+		size_t index;
+		found += array_linear_search(arr, GET_PTR(TestArray, -1 - (int) (r & 1), 0), cmp_func, &index);
+	}
+
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	exit_if_fail(found == 0);
+
+	return seconds * 1e9 / ((double) repeats * len);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t elements = (argc > 1) ? strtoul(argv[1], NULL, 10) : ELEMENTS_PER_CELL;
+
+	printf("Miss scans of {int key; int value}, ns per element\n");
+	printf("%10s %10s", "len", "cmp_func");
+
+	for (SearchIsa isa = SEARCH_ISA_AVX2; isa >= SEARCH_ISA_SCALAR; --isa)
+		printf(" %8s", isa_names[isa]);
+
+	printf("\n");
+
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l)
+	{
+		size_t len = lengths[l];
+		Array *arr = array_new_with_key(false, false, sizeof(TestArray), NULL,
+				SEARCH_KEY_INT32, offsetof(TestArray, key));
+		exit_if_fail(arr != NULL);
+
+		for (size_t i = 0; i < len; ++i)
+			array_append(arr, GET_PTR(TestArray, (int) i, (int) i));
+
+		printf("%10lu %10.2lf", len, scan(arr, len, test_array_cmp, elements / 8));
+
+		for (SearchIsa isa = SEARCH_ISA_AVX2; isa >= SEARCH_ISA_SCALAR; --isa)
+		{
+			if (search_scan_set_isa(isa))
+				printf(" %8.2lf", scan(arr, len, NULL, elements));
+			else
+				printf(" %8s", "-");
+		}
+
+		printf("\n");
+
+		search_scan_set_isa(SEARCH_ISA_AUTO);
+		array_delete(arr);
+	}
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Base.h"
+#include "Utils/Sort.h"
+
+#define LEN 5000000
+
+typedef struct _Record
+{
+	int key;
+	int value;
+} Record;
+
+typedef enum
+{
+	PATTERN_RANDOM,
+	PATTERN_SORTED,
+	PATTERN_REVERSED,
+	PATTERN_SAWTOOTH,
+	PATTERN_FEW_VALUES,
+	PATTERN_ORGAN_PIPE,
+	PATTERN_ALL_EQUAL,
+	PATTERN_COUNT
+} Pattern;
+
+static const char *pattern_names[] = {
+	"random",
+	"sorted",
+	"reversed",
+	"sawtooth",
+	"16 keys",
+	"organ pipe",
+	"all equal"
+};
+
+int record_cmp(const void *a, const void *b)
+{
+	const Record *ra = a;
+	const Record *rb = b;
+
+	return (ra->key > rb->key) - (ra->key < rb->key);
+}
+
+void fill(Record *mass, size_t len, Pattern pattern)
+{
+	for (size_t i = 0; i < len; ++i)
+	{
+		switch (pattern)
+		{
+			case PATTERN_RANDOM:
+				mass[i].key = (int) (((unsigned) rand() << 16) ^ (unsigned) rand());
+				break;
+			case PATTERN_SORTED:
+				mass[i].key = (int) i;
+				break;
+			case PATTERN_REVERSED:
+				mass[i].key = (int) (len - i);
+				break;
+			case PATTERN_SAWTOOTH:
+				mass[i].key = (int) (i % 1000);
+				break;
+			case PATTERN_FEW_VALUES:
+				mass[i].key = rand() % 16;
+				break;
+			case PATTERN_ORGAN_PIPE:
+				mass[i].key = (int) ((i < len / 2) ? (i) : (len - i));
+				break;
+			default:
+				mass[i].key = 0;
+				break;
+		}
+
+		mass[i].value = (int) i;
+	}
+}
+
+bool is_sorted(const Record *mass, size_t len)
+{
+	for (size_t i = 1; i < len; ++i)
+		if (mass[i - 1].key > mass[i].key)
+			return false;
+
+	return true;
+}
+
+double elapsed(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t len = (argc > 1) ? strtoul(argv[1], NULL, 10) : LEN;
+
+	Record *source = malloc(len * sizeof(Record));
+	Record *mass = malloc(len * sizeof(Record));
+
+	exit_if_fail(source != NULL && mass != NULL);
+
+	srand(1);
+
+	printf("%lu {int key; int value} records (seconds)\n", len);
+	printf("  %-12s %-12s %s\n", "", "quicksort", "qsort");
+
+	for (Pattern p = PATTERN_RANDOM; p < PATTERN_COUNT; ++p)
+	{
+		fill(source, len, p);
+
+		memcpy(mass, source, len * sizeof(Record));
+		clock_t start = clock();
+		quicksort(mass, len, sizeof(Record), record_cmp);
+		double t_quicksort = elapsed(start);
+		bool sorted = is_sorted(mass, len);
+
+		memcpy(mass, source, len * sizeof(Record));
+		start = clock();
+		qsort(mass, len, sizeof(Record), record_cmp);
+		double t_qsort = elapsed(start);
+
+		printf("  %-12s %-12lf %lf%s\n", pattern_names[p], t_quicksort, t_qsort, (sorted) ? "" : "  NOT SORTED");
+	}
+
+	free(source);
+	free(mass);
+
+	return 0;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "Base.h"
+#include "Utils/Sort.h"
+#include "DataStructs/Array.h"
+
+#define LEN 5000000
+
+typedef enum
+{
+	PATTERN_RANDOM,
+	PATTERN_SORTED,
+	PATTERN_REVERSED,
+	PATTERN_FEW_VALUES
+} Pattern;
+
+static const char *pattern_names[] = {
+	"random",
+	"sorted",
+	"reversed",
+	"16 values"
+};
+
+int int32_cmp(const void *a, const void *b)
+{
+	int32_t ia = *(const int32_t*) a;
+	int32_t ib = *(const int32_t*) b;
+
+	return (ia > ib) - (ia < ib);
+}
+
+typedef struct _Record
+{
+	int key;
+	int value;
+} Record;
+
+int record_cmp(const void *a, const void *b)
+{
+	const Record *ra = a;
+	const Record *rb = b;
+
+	return (ra->key > rb->key) - (ra->key < rb->key);
+}
+
+int double_cmp(const void *a, const void *b)
+{
+	double da = *(const double*) a;
+	double db = *(const double*) b;
+
+	return (da > db) - (da < db);
+}
+
+void fill_int32(int32_t *mass, size_t len, Pattern pattern)
+{
+	for (size_t i = 0; i < len; ++i)
+	{
+		switch (pattern)
+		{
+			case PATTERN_RANDOM:
+				mass[i] = (int32_t) (((unsigned) rand() << 16) ^ (unsigned) rand());
+				break;
+			case PATTERN_SORTED:
+				mass[i] = (int32_t) i;
+				break;
+			case PATTERN_REVERSED:
+				mass[i] = (int32_t) (len - i);
+				break;
+			case PATTERN_FEW_VALUES:
+				mass[i] = rand() % 16;
+				break;
+		}
+	}
+}
+
+double elapsed(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+bool records_sorted(Array *arr, size_t len)
+{
+	Record prev, cur;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		array_get(arr, i, &cur);
+
+		if (i > 0 && prev.key > cur.key)
+			return false;
+
+		prev = cur;
+	}
+
+	return true;
+}
+
+/* Keyed Array of {int key; int value}: array_sort() with cmp_func against the typed key */
+void bench_records(const int32_t *keys, size_t len, Pattern pattern)
+{
+	Array *generic = array_new_with_key(false, false, sizeof(Record), NULL, SEARCH_KEY_INT32, offsetof(Record, key));
+	Array *typed = array_new_with_key(false, false, sizeof(Record), NULL, SEARCH_KEY_INT32, offsetof(Record, key));
+	exit_if_fail(generic != NULL && typed != NULL);
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		array_append(generic, &(Record) { keys[i], (int) i });
+		array_append(typed, &(Record) { keys[i], (int) i });
+	}
+
+	clock_t start = clock();
+	array_sort(generic, record_cmp);
+	double t_generic = elapsed(start);
+
+	start = clock();
+	array_sort(typed, NULL);
+	double t_typed = elapsed(start);
+
+	printf("  record %-9s %lf  %lf%s\n", pattern_names[pattern], t_generic, t_typed,
+			(records_sorted(generic, len) && records_sorted(typed, len)) ? "" : "  NOT SORTED");
+
+	array_delete(generic);
+	array_delete(typed);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t len = (argc > 1) ? strtoul(argv[1], NULL, 10) : LEN;
+
+	int32_t *source = malloc(len * sizeof(int32_t));
+	int32_t *generic = malloc(len * sizeof(int32_t));
+	int32_t *typed = malloc(len * sizeof(int32_t));
+
+	double *dsource = malloc(len * sizeof(double));
+	double *dgeneric = malloc(len * sizeof(double));
+	double *dtyped = malloc(len * sizeof(double));
+
+	exit_if_fail(source != NULL && generic != NULL && typed != NULL);
+	exit_if_fail(dsource != NULL && dgeneric != NULL && dtyped != NULL);
+
+	srand(1);
+
+	printf("%lu keys, quicksort() vs the typed kernel (seconds)\n", len);
+
+	for (Pattern p = PATTERN_RANDOM; p <= PATTERN_FEW_VALUES; ++p)
+	{
+		fill_int32(source, len, p);
+		memcpy(generic, source, len * sizeof(int32_t));
+		memcpy(typed, source, len * sizeof(int32_t));
+
+		clock_t start = clock();
+		quicksort(generic, len, sizeof(int32_t), int32_cmp);
+		double t_generic = elapsed(start);
+
+		start = clock();
+		sort_int32(typed, len);
+		double t_typed = elapsed(start);
+
+		printf("  int32 %-10s %lf  %lf%s\n", pattern_names[p], t_generic, t_typed,
+				(memcmp(generic, typed, len * sizeof(int32_t)) == 0) ? "" : "  MISMATCH");
+	}
+
+	for (Pattern p = PATTERN_RANDOM; p <= PATTERN_FEW_VALUES; ++p)
+	{
+		fill_int32(source, len, p);
+		bench_records(source, len, p);
+	}
+
+	for (size_t i = 0; i < len; ++i)
+		dsource[i] = (double) rand() / RAND_MAX - 0.5;
+
+	memcpy(dgeneric, dsource, len * sizeof(double));
+	memcpy(dtyped, dsource, len * sizeof(double));
+
+	clock_t start = clock();
+	quicksort(dgeneric, len, sizeof(double), double_cmp);
+	double t_generic = elapsed(start);
+
+	start = clock();
+	sort_double(dtyped, len);
+	double t_typed = elapsed(start);
+
+	printf("  double %-9s %lf  %lf%s\n", "random", t_generic, t_typed,
+			(memcmp(dgeneric, dtyped, len * sizeof(double)) == 0) ? "" : "  MISMATCH");
+
+	free(source);
+	free(generic);
+	free(typed);
+	free(dsource);
+	free(dgeneric);
+	free(dtyped);
+
+	return 0;
+}
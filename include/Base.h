@@ -6,5 +6,7 @@
 #include "Base/Definitions.h"
 #include "Base/Messages.h"
 #include "Base/Macros.h"
+#include "Base/Pool.h"
+#include "Base/Arena.h"
 
 #endif /* end of include guard: BASE_H_47OHMYVS */
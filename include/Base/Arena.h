@@ -0,0 +1,30 @@
+#ifndef ARENA_H_T5WQO2LE
+#define ARENA_H_T5WQO2LE
+
+#include <stddef.h>
+
+#include "Object.h"
+
+/*
+ * Arena is a bump allocator for objects that die together.
+ * Objects created with object_new_in() and their internal buffers
+ * are taken from the arena, and arena_reset() releases all of them
+ * at once without calling their destructors.
+ *
+ * Nodes of lists and trees created in an arena are arena memory too,
+ * so their node free funcs (if any) must not free the nodes themselves.
+ */
+
+#define ARENA_TYPE (arena_get_type())
+DECLARE_TYPE(Arena, arena, ARENA, Object);
+
+#define ARENA_CHUNK_SIZE 65536
+
+Arena* arena_new(size_t chunk_size);
+void arena_delete(Arena *self);
+void arena_reset(Arena *self);
+void* arena_alloc(Arena *self, size_t size);
+void* arena_realloc(Arena *self, void *ptr, size_t old_size, size_t new_size);
+size_t arena_get_used(const Arena *self);
+
+#endif /* end of include guard: ARENA_H_T5WQO2LE */
@@ -16,29 +16,29 @@ struct _Interface
 
 #define USE_INTERFACE(type, init) (type), (init)
 
-#define DEFINE_INTERFACE(TN, t_n) 																	\
-	static Type __##TN##Interface; 																	\
-	Type t_n##_interface_get_type(void) 															\
-	{ 																								\
-		if (!__##TN##Interface) 																	\
-		{ 																							\
-			__##TN##Interface = interface_type_new(TOSTR(TN##Interface), sizeof(TN##Interface), 0); \
-		} 																							\
-																									\
-		return __##TN##Interface; 																	\
-	}
-
-#define DEFINE_INTERFACE_WITH_IFACES(TN, t_n, IFC, IFS...) 													\
-	static Type __##TN##Interface; 																			\
-	Type t_n##_interface_get_type(void) 																	\
-	{ 																										\
-		if (!__##TN##Interface) 																			\
-		{ 																									\
-			__##TN##Interface = interface_type_new(TOSTR(TN##Interface), sizeof(TN##Interface), IFC, IFS); 	\
-		} 																									\
-																											\
-		return __##TN##Interface; 																			\
-	}
+#define DEFINE_INTERFACE(TN, t_n)                                                                  \
+	static _Atomic(Type) __##TN##Interface;                                                        \
+	Type t_n##_interface_get_type(void)                                                            \
+	{                                                                                              \
+		TYPE_ONCE(__##TN##Interface,                                                               \
+				interface_type_new(TOSTR(TN##Interface), sizeof(TN##Interface), 0));               \
+	}                                                                                              \
+	TYPE_INIT_REGISTER(t_n##_interface)
+
+#define DEFINE_INTERFACE_WITH_IFACES(TN, t_n, IFC, IFS...)                                         \
+	static _Atomic(Type) __##TN##Interface;                                                        \
+	Type t_n##_interface_get_type(void)                                                            \
+	{                                                                                              \
+		TYPE_ONCE(__##TN##Interface,                                                               \
+				interface_type_new(TOSTR(TN##Interface), sizeof(TN##Interface), IFC, IFS));        \
+	}                                                                                              \
+	TYPE_INIT_REGISTER(t_n##_interface)
+
+#ifdef OOP_UNCHECKED
+#define DECLARE_INTERFACE_IS(module_obj_name, self) ((const void*) (self) != NULL)
+#else
+#define DECLARE_INTERFACE_IS(module_obj_name, self) (hasInterface(module_obj_name##_interface_get_type(), (const void*) self))
+#endif /* OOP_UNCHECKED */
 
 #define DECLARE_INTERFACE(ModuleObjName, module_obj_name, MODULE_OBJ_NAME)												\
 	typedef struct _##ModuleObjName##Interface ModuleObjName##Interface;												\
@@ -47,7 +47,7 @@ struct _Interface
 	inline ModuleObjName##Interface* MODULE_OBJ_NAME##_INTERFACE(const ModuleObjName *self) {							\
 		return (ModuleObjName##Interface*)interface_cast(module_obj_name##_interface_get_type(), (const void*) self); } \
 	inline bool IS_##MODULE_OBJ_NAME(const ModuleObjName *self) { 														\
-		return hasInterface(module_obj_name##_interface_get_type(), (const void*) self); }
+		return DECLARE_INTERFACE_IS(module_obj_name, self); }
 	
 Type isInterfaceType(Type itype);
 const Interface* isInterface(const void *_iface);
@@ -55,6 +55,7 @@ bool hasInterface(Type itype, const void *self);
 Interface* interface_find(Type itype, Interface **ifaces, size_t ifaces_count);
 void* interface_cast(Type itype, const void *self);
 void interface_init_all(Interface **ifaces, size_t ifaces_count);
+Interface** interface_slots_new(Interface **ifaces, size_t ifaces_count, size_t *slots_count);
 Interface* interface_copy(Interface *iface);
 Type interface_type_new(char *name, size_t size, size_t itypes_count, ...);
 Interface* interface_new(Type interface_type, void (*init)(Interface *iface));
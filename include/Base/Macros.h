@@ -4,6 +4,9 @@
 #define STRFUNC ((const char*) (__PRETTY_FUNCTION__))
 #define GNUC_UNUSED __attribute__((__unused__))
 
+/* The expression is still evaluated, but the compiler may rely on it being true */
+#define ASSUME(expr) do { if (!(expr)) __builtin_unreachable(); } while (0)
+
 #define GET_PTR(type, ...) ((type*) &((type){__VA_ARGS__}))
 
 #define INT_TO_PTR(v) ((void*) (long) (v))
@@ -2,6 +2,8 @@
 #define MESSAGES_H_V1NHZAPH
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 
 /*
  *  ERROR: 		Something "serious" has gone wrong. But the program can recover from it.
@@ -29,6 +31,22 @@ void message_func(MessageFlags flag, const char *func, const char *msg, ...);
 void return_if_fail_warning(const char* func, const char *expr);
 void exit_if_fail_critical(const char *func, const char *expr);
 
+/*
+ * Asynchronous mode: the message is formatted on the caller's thread into
+ * the thread's ring buffer and written by the background thread.
+ * When the ring is full, the message is dropped and counted.
+ * A record holds MESSAGE_RECORD_LEN bytes with the colours and the function
+ * name, a longer message is cut and ends with "...".
+ * The rings are flushed at exit.
+ */
+#define MESSAGE_RING_SIZE 1024
+#define MESSAGE_RECORD_LEN 256
+#define MESSAGE_DRAIN_INTERVAL_MS 10
+
+bool   message_async_enable(size_t ring_size);
+void   message_flush(void);
+size_t message_get_dropped(void);
+
 #define return_if_fail(expr) 							\
 	if (!(expr)) 										\
 	{ 													\
@@ -57,11 +75,86 @@ void exit_if_fail_critical(const char *func, const char *expr);
 		exit(code); 									\
 	}
 
-#define msg_error(...) 		(message_func(MESSAGE_ERROR, 	STRFUNC, __VA_ARGS__))
-#define msg_warn(...) 		(message_func(MESSAGE_WARNING,  STRFUNC, __VA_ARGS__))
-#define msg_critical(...) 	(message_func(MESSAGE_CRITICAL, STRFUNC, __VA_ARGS__))
-#define msg_info(...) 		(message_func(MESSAGE_INFO,  	STRFUNC, __VA_ARGS__))
-#define msg_debug(...) 		(message_func(MESSAGE_DEBUG,  	STRFUNC, __VA_ARGS__))
-#define msg_print(...) 		(message_func(MESSAGE_PRINT,  	STRFUNC, __VA_ARGS__))
+/*
+ * Guards of the arguments and of their types. The unchecked build doesn't
+ * check them at runtime, they only tell the compiler what it may assume.
+ * The results of allocations and I/O are always checked by the ones above.
+ */
+#ifdef OOP_UNCHECKED
+
+#define arg_return_if_fail(expr) ASSUME(expr)
+#define arg_return_val_if_fail(expr, val) ASSUME(expr)
+
+#else
+
+#define arg_return_if_fail(expr) return_if_fail(expr)
+#define arg_return_val_if_fail(expr, val) return_val_if_fail(expr, val)
+
+#endif /* OOP_UNCHECKED */
+
+/*
+ * The messages with flag above MESSAGE_LEVEL are compiled out together
+ * with their arguments, the rest are filtered at runtime by message_set_level().
+ * Levels follow the order of MessageFlags (0 is ERROR, 5 is DEBUG), except
+ * CRITICAL, which ranks with ERROR and passes wherever ERROR does.
+ */
+#ifndef MESSAGE_LEVEL
+#if ENABLE_MSG == 0
+#define MESSAGE_LEVEL -1
+#else
+#define MESSAGE_LEVEL 5
+#endif
+#endif
+
+extern atomic_int message_level;
+
+#define message_rank(flag) (((flag) == MESSAGE_CRITICAL) ? (int) MESSAGE_ERROR : (int) (flag))
+
+#define message_enabled(flag) \
+	(message_rank(flag) <= MESSAGE_LEVEL && message_rank(flag) <= atomic_load_explicit(&message_level, memory_order_relaxed))
+
+void message_set_level(MessageFlags level);
+MessageFlags message_get_level(void);
+
+/*
+ * Token bucket of the call site: MESSAGE_RATE_BURST messages at once,
+ * refilled by MESSAGE_RATE_PER_SEC, the rest is suppressed and counted.
+ */
+#define MESSAGE_RATE_BURST 10
+#define MESSAGE_RATE_PER_SEC 10
+
+typedef struct
+{
+	atomic_long stamp;
+	atomic_long tokens;
+	atomic_ulong suppressed;
+} MessageRateLimit;
+
+bool message_rate_limit(MessageRateLimit *rl, MessageFlags flag, const char *func);
+
+#define MESSAGE_AT(flag, ...)                               \
+	do {                                                    \
+		if (message_enabled(flag))                          \
+			message_func((flag), STRFUNC, __VA_ARGS__);     \
+	} while (0)
+
+#define MESSAGE_AT_LIMITED(flag, ...)                                      \
+	do {                                                                   \
+		static MessageRateLimit __rl;                                      \
+		if (message_enabled(flag) && message_rate_limit(&__rl, (flag), STRFUNC)) \
+			message_func((flag), STRFUNC, __VA_ARGS__);                    \
+	} while (0)
+
+#define msg_error(...) 		MESSAGE_AT(MESSAGE_ERROR, 	 __VA_ARGS__)
+#define msg_warn(...) 		MESSAGE_AT(MESSAGE_WARNING,  __VA_ARGS__)
+#define msg_critical(...) 	MESSAGE_AT(MESSAGE_CRITICAL, __VA_ARGS__)
+#define msg_info(...) 		MESSAGE_AT(MESSAGE_INFO,  	 __VA_ARGS__)
+#define msg_debug(...) 		MESSAGE_AT(MESSAGE_DEBUG,  	 __VA_ARGS__)
+#define msg_print(...) 		MESSAGE_AT(MESSAGE_PRINT,  	 __VA_ARGS__)
+
+#define msg_error_limited(...) 	MESSAGE_AT_LIMITED(MESSAGE_ERROR, 	__VA_ARGS__)
+#define msg_warn_limited(...) 	MESSAGE_AT_LIMITED(MESSAGE_WARNING, __VA_ARGS__)
+#define msg_info_limited(...) 	MESSAGE_AT_LIMITED(MESSAGE_INFO, 	__VA_ARGS__)
+#define msg_debug_limited(...) 	MESSAGE_AT_LIMITED(MESSAGE_DEBUG, 	__VA_ARGS__)
 
 #endif /* end of include guard: MESSAGES_H_V1NHZAPH */
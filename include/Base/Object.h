@@ -4,78 +4,106 @@
 #include <stddef.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #include "Interface.h"
 #include "Definitions.h"
 #include "Macros.h"
 
+/*
+ * Types are registered lazily on the first call of *_get_type().
+ * The registration is done under the global type lock, so the type
+ * is never registered twice, and after that it's just an acquire load.
+ */
+#define TYPE_ONCE(storage, ...)                                              \
+	Type __type = atomic_load_explicit(&(storage), memory_order_acquire);    \
+	if (__type == 0)                                                         \
+	{                                                                        \
+		types_lock();                                                        \
+		__type = atomic_load_explicit(&(storage), memory_order_relaxed);     \
+		if (__type == 0)                                                     \
+		{                                                                    \
+			__type = (Type) (__VA_ARGS__);                                   \
+			atomic_store_explicit(&(storage), __type, memory_order_release); \
+		}                                                                    \
+		types_unlock();                                                      \
+	}                                                                        \
+	return __type;
+
+#define TYPE_INIT_REGISTER(t_n)                                              \
+	static TypeInitNode __##t_n##_init_node = { t_n##_get_type, NULL };      \
+	__attribute__((constructor)) static void t_n##_init_register(void)       \
+	{                                                                        \
+		types_init_register(&__##t_n##_init_node);                           \
+	}
+
 #define DEFINE_TYPE(TN, t_n, t_p)                                        \
-	static Type __##TN##Class;                                           \
+	static _Atomic(Type) __##TN##Class;                                  \
 	Type t_n##_class_get_type(void)                                      \
 	{                                                                    \
-		if (!__##TN##Class)                                              \
-		{                                                                \
-			__##TN##Class = (Type) object_new(t_p##_class_get_type(),    \
+		TYPE_ONCE(__##TN##Class, object_new(t_p##_class_get_type(),      \
 					TOSTR(TN##Class),                                    \
 					t_p##_class_get_type(),                              \
 					sizeof(TN##Class),                                   \
 					NULL,                                                \
-					0);                                                  \
-		}                                                                \
-																		 \
-		return __##TN##Class;                                            \
+					0));                                                 \
 	}                                                                    \
 	static void t_n##_class_init(TN##Class *klass);                      \
-	static Type __##TN;                                                  \
+	static _Atomic(Type) __##TN;                                         \
 	Type t_n##_get_type(void)                                            \
 	{                                                                    \
-		if (!__##TN)                                                     \
-		{                                                                \
-			__##TN = (Type) object_new((t_n##_class_get_type()),         \
+		TYPE_ONCE(__##TN, object_new((t_n##_class_get_type()),           \
 					#TN,                                                 \
 					t_p##_get_type(),                                    \
 					sizeof(TN),                                          \
 					t_n##_class_init,                                    \
-					0);                                                  \
-		}                                                                \
-																		 \
-		return __##TN;                                                   \
-	}
+					0));                                                 \
+	}                                                                    \
+	TYPE_INIT_REGISTER(t_n)
 
 #define DEFINE_TYPE_WITH_IFACES(TN, t_n, t_p, IFC, IFS...)               \
-	static Type __##TN##Class;                                           \
+	static _Atomic(Type) __##TN##Class;                                  \
 	Type t_n##_class_get_type(void)                                      \
 	{                                                                    \
-		if (!__##TN##Class)                                              \
-		{                                                                \
-			__##TN##Class = (Type) object_new(t_p##_class_get_type(),    \
+		TYPE_ONCE(__##TN##Class, object_new(t_p##_class_get_type(),      \
 					TOSTR(TN##Class),                                    \
 					t_p##_class_get_type(),                              \
 					sizeof(TN##Class),                                   \
 					NULL,                                                \
-					0);                                                  \
-		}                                                                \
-																		 \
-		return __##TN##Class;                                            \
+					0));                                                 \
 	}                                                                    \
 	static void t_n##_class_init(TN##Class *klass);                      \
-	static Type __##TN;                                                  \
+	static _Atomic(Type) __##TN;                                         \
 	Type t_n##_get_type(void)                                            \
 	{                                                                    \
-		if (!__##TN)                                                     \
-		{                                                                \
-			__##TN = (Type) object_new((t_n##_class_get_type()),         \
+		TYPE_ONCE(__##TN, object_new((t_n##_class_get_type()),           \
 					#TN,                                                 \
 					t_p##_get_type(),                                    \
 					sizeof(TN),                                          \
 					t_n##_class_init,                                    \
 					IFC, IFS,                                            \
-					0);                                                  \
-		}                                                                \
-																		 \
-		return __##TN;                                                   \
-	}
+					0));                                                 \
+	}                                                                    \
+	TYPE_INIT_REGISTER(t_n)
 
+#ifdef OOP_UNCHECKED
+
+/* Unchecked build: casts don't check the type, and IS_* only checks for NULL */
+#define DECLARE_TYPE_BODY(ModuleObjName, module_obj_name, MODULE_OBJ_NAME)                 \
+	Type module_obj_name##_get_type(void);                                                 \
+	Type module_obj_name##_class_get_type(void);                                           \
+	GNUC_UNUSED static inline ModuleObjName* MODULE_OBJ_NAME(const Object *self) {                            \
+		return (ModuleObjName*) self; }                                                    \
+	GNUC_UNUSED static inline ModuleObjName##Class* MODULE_OBJ_NAME##_CLASS(const ObjectClass *klass) {       \
+		return (ModuleObjName##Class*) klass; }                                            \
+	GNUC_UNUSED static inline ModuleObjName##Class* MODULE_OBJ_NAME##_GET_CLASS(const ModuleObjName *self) {  \
+		return (ModuleObjName##Class*)classOf(self); }                                     \
+	GNUC_UNUSED static inline bool IS_##MODULE_OBJ_NAME(const ModuleObjName *self) {                          \
+		return self != NULL; }                                                             \
+	GNUC_UNUSED static inline bool IS_##MODULE_OBJ_NAME##_CLASS(const ModuleObjName##Class *klass) {          \
+		return klass != NULL; }
+
+#else
 
 #define DECLARE_TYPE_BODY(ModuleObjName, module_obj_name, MODULE_OBJ_NAME)                 \
 	Type module_obj_name##_get_type(void);                                                 \
@@ -91,6 +119,8 @@
 	GNUC_UNUSED static inline bool IS_##MODULE_OBJ_NAME##_CLASS(const ModuleObjName##Class *klass) {          \
 		return isOf(klass, module_obj_name##_class_get_type()); }
 
+#endif /* OOP_UNCHECKED */
+
 #define DECLARE_TYPE(ModuleObjName, module_obj_name, MODULE_OBJ_NAME, ParentName) \
 	typedef struct _##ModuleObjName ModuleObjName;                                \
 	typedef struct { ParentName##Class parent; } ModuleObjName##Class;            \
@@ -104,16 +134,19 @@
 typedef struct _Object Object;
 typedef struct _ObjectClass ObjectClass;
 
+typedef struct _Arena Arena;
+
 struct _Object
 {
-	void *private[2];
+	void *private[4];
 };
 
 struct _ObjectClass
 {
-	void *private[7];
+	void *private[14];
 
 	Object* (*ctor)(Object *self, va_list *ap);
+	Object* (*ctor_typed)(Object *self, const void *params);
 	Object* (*dtor)(Object *self, va_list *ap);
 	Object* (*cpy)(const Object *self, Object *object, va_list *ap);
 
@@ -124,18 +157,43 @@ struct _ObjectClass
 #define OBJECT_TYPE (object_get_type())
 #define OBJECT_CLASS_TYPE (object_class_get_type())
 
+#ifdef OOP_UNCHECKED
+
+#define OBJECT(self) ((Object*) (self))
+#define OBJECT_CLASS(klass) ((ObjectClass*) (klass))
+
+#define IS_OBJECT(self) ((const void*) (self) != NULL)
+#define IS_OBJECT_CLASS(klass) ((const void*) (klass) != NULL)
+
+#else
+
 #define OBJECT(self) ((Object*)(cast(object_get_type(), (const void*) self)))
 #define OBJECT_CLASS(klass) ((ObjectClass*)(cast(object_class_get_type(), (const void*) klass)))
 
 #define IS_OBJECT(self) (isOf((const void*) self, object_get_type()))
 #define IS_OBJECT_CLASS(klass) (isOf((const void*) klass, object_class_get_type()))
 
+#endif /* OOP_UNCHECKED */
+
 #define OBJECT_GET_CLASS(self) ((ObjectClass*)(classOf((const void*) self)))
 #define OBJECT_SIZE(self) (sizeOf((const void*) self))
 
+typedef struct _TypeInitNode TypeInitNode;
+
+struct _TypeInitNode
+{
+	Type (*get_type)(void);
+	TypeInitNode *next;
+};
+
 Type object_get_type(void);
 Type object_class_get_type(void);
 
+void types_lock(void);
+void types_unlock(void);
+void types_init_register(TypeInitNode *node);
+void types_init_all(void);
+
 const void* isObject(const void *self);
 const void* classOf(const void *self);
 
@@ -144,11 +202,40 @@ size_t sizeOf(const void *self);
 bool   isOf(const void *self, Type object_type);
 
 Object* object_new(Type object_type, ...);
+Object* object_new_in(Arena *arena, Type object_type, ...);
+Object* object_new_typed(Type object_type, const void *params);
 Object* object_new_stack(Type object_type, void *object, ...);
 void    object_delete(Object *self, ...);
 Object* object_copy(const Object *self, ...);
 
+Object* object_ref(Object *self);
+void    object_unref(Object *self);
+size_t  object_get_refcount(const Object *self);
+
 Object* object_set(Object *self, ...);
 void object_get(const Object *self, ...);
 
+/* 
+ * Memory of the object's internal buffers.
+ * It's taken from the arena, if the object was created in one.
+ */
+Arena* object_get_arena(const Object *self);
+void*  object_mem_alloc(const Object *self, size_t size);
+void*  object_mem_realloc(const Object *self, void *ptr, size_t old_size, size_t new_size);
+void   object_mem_free(const Object *self, void *ptr);
+
+/*
+ * Reference counted memory blocks for copy-on-write containers.
+ * A block can be changed in place only while it is unique,
+ * otherwise the owner has to copy it first.
+ */
+void* object_shared_new(const Object *self, size_t size);
+void* object_shared_resize(const Object *self, void *ptr, size_t old_size, size_t new_size);
+void* object_shared_ref(void *ptr);
+bool  object_shared_unref(const Object *self, void *ptr);
+bool  object_shared_is_unique(const void *ptr);
+
+void object_class_enable_pool(Type object_type);
+bool object_pool_stats(Type object_type, size_t *live, size_t *pooled);
+
 #endif /* end of include guard: OBJECT_H_IEJNPLAH */
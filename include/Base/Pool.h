@@ -0,0 +1,23 @@
+#ifndef POOL_H_Q3MZK8TD
+#define POOL_H_Q3MZK8TD
+
+#include <stddef.h>
+
+/*
+ * Free-list allocator for objects of the same size.
+ * Every thread keeps its own cache of free blocks,
+ * the surplus is spilled to the pool shared between threads.
+ */
+
+#define OBJECT_POOL_MAX 32
+#define OBJECT_POOL_CACHE_MAX 64
+#define OBJECT_POOL_SPILL_MAX 4096
+
+typedef struct _ObjectPool ObjectPool;
+
+ObjectPool* object_pool_get(size_t size);
+void* object_pool_alloc(ObjectPool *pool);
+void object_pool_free(ObjectPool *pool, void *ptr);
+void object_pool_get_stats(ObjectPool *pool, size_t *live, size_t *pooled);
+
+#endif /* end of include guard: POOL_H_Q3MZK8TD */
@@ -6,11 +6,25 @@
 
 #include "Base.h"
 #include "Interfaces/StringerInterface.h"
+#include "Utils/Sort.h"
+#include "Utils/Search.h"
 
 #define ARRAY_TYPE (array_get_type())
 DECLARE_TYPE(Array, array, ARRAY, Object);
 
+typedef struct
+{
+	bool clear;
+	bool zero_terminated;
+	size_t elemsize;
+	FreeFunc free_func;
+	SearchKeyType key_type; // The linear searches and array_sort() with NULL cmp_func compare this key
+	size_t key_offset;
+} ArrayParams;
+
 Array* array_new(bool clear, bool zero_terminated, size_t elemsize, FreeFunc free_func);
+Array* array_new_with_key(bool clear, bool zero_terminated, size_t elemsize, FreeFunc free_func,
+                          SearchKeyType key_type, size_t key_offset);
 Array* array_copy(const Array *self);
 Array* array_set(Array *self, size_t index, const void *data);
 void array_get(const Array *self, size_t index, void *ret);
@@ -22,10 +36,26 @@ Array* array_prepend_many(Array *self, const void *data, size_t len);
 Array* array_insert_many(Array *self, size_t index, const void *data, size_t len);
 Array* array_remove_index(Array *self, size_t index);
 Array* array_remove_range(Array *self, size_t index, size_t len);
+Array* array_insert_sorted(Array *self, const void *data, CmpFunc cmp_func);
 Array* array_remove_val(Array *self, const void *target, CmpFunc cmp_func, bool remove_all);
 void array_sort(Array *self, CmpFunc cmp_func);
+/* Only for the arrays of bare keys, the keyed records are sorted by array_sort() with NULL cmp_func */
+void array_sort_typed(Array *self, SortKeyType key_type);
+bool array_sort_stable(Array *self, CmpFunc cmp_func, size_t *comparisons);
+bool array_sort_by_key(Array *self, size_t key_offset, size_t key_width, RadixFlags flags);
+bool array_sort_parallel(Array *self, CmpFunc cmp_func, size_t workers, ParallelSortFlags flags);
+bool array_sort_indirect(Array *self, CmpFunc cmp_func);
+size_t* array_argsort(const Array *self, CmpFunc cmp_func);
+bool array_permute(Array *self, const size_t *perm);
+bool array_nth(Array *self, size_t n, CmpFunc cmp_func, void *ret);
+Array* array_top_k(const Array *self, size_t k, CmpFunc cmp_func);
 bool array_binary_search(Array *self, const void *target, CmpFunc cmp_func, size_t *index);
+ssize_t array_lower_bound(const Array *self, const void *target, CmpFunc cmp_func);
+ssize_t array_upper_bound(const Array *self, const void *target, CmpFunc cmp_func);
+size_t array_search_batch(const Array *self, const void *keys, size_t nkeys, CmpFunc cmp_func, size_t *out_indices);
+bool array_build_search_index(const Array *self, CmpFunc cmp_func, SearchIndex *index);
 bool array_linear_search(const Array *self, const void *target, CmpFunc cmp_func, size_t *index);
+size_t array_count_val(const Array *self, const void *target, CmpFunc cmp_func);
 Array* array_unique(Array *self, CmpFunc cmp_func);
 void array_delete(Array *self);
 void* array_steal(Array *self, size_t *len);
@@ -21,6 +21,17 @@ typedef enum
 	BI_INIT_SIZED
 } BigIntInitType;
 
+typedef struct
+{
+	BigIntInitType init;
+	union
+	{
+		const char *str;
+		int value;
+		size_t size;
+	};
+} BigIntParams;
+
 typedef enum
 {
 	BI_SET_STR = 120,
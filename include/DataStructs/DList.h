@@ -9,6 +9,13 @@
 #define DLIST_TYPE (dlist_get_type())
 DECLARE_TYPE(DList, dlist, DLIST, Object);
 
+typedef struct
+{
+	size_t size;
+	FreeFunc free_func;
+	CpyFunc cpy_func;
+} DListParams;
+
 typedef struct _DlistNode DListNode;
 
 /* Dont touch fields, if you want it to work correctly */
@@ -9,6 +9,13 @@
 #define SLIST_TYPE (slist_get_type())
 DECLARE_TYPE(SList, slist, SLIST, Object);
 
+typedef struct
+{
+	size_t size;
+	FreeFunc free_func;
+	CpyFunc cpy_func;
+} SListParams;
+
 typedef struct _SListNode SListNode;
 
 /* Dont touch fields, if you want it to work correctly */
@@ -7,6 +7,9 @@
 #define TREE_TYPE (tree_get_type())
 DECLARE_TYPE(Tree, tree, TREE, Object);
 
+/* The batched lookups keep this many searches in flight */
+#define TREE_LOOKUP_BATCH_GROUP 16
+
 typedef enum
 {
 	BLACK,
@@ -15,6 +18,15 @@ typedef enum
 
 typedef struct _TreeNode TreeNode;
 
+typedef struct
+{
+	size_t size;
+	CmpFunc key_cmp_func;
+	FreeFunc key_free_func;
+	FreeFunc node_free_func;
+	CpyFunc node_cpy_func;
+} TreeParams;
+
 /* Dont touch fields, if you want it to work correctly */
 
 struct _TreeNode
@@ -30,7 +42,10 @@ Tree* tree_new(size_t size, CmpFunc key_cmp_func, FreeFunc key_free_func, FreeFu
 void tree_delete(Tree *self);
 Tree* tree_copy(const Tree *self);
 TreeNode* tree_insert(Tree *self, void *key);
-TreeNode* tree_lookup(const Tree *self, const void *key);
+/* The found nodes can be changed, the tree stops sharing its nodes with the copies first */
+TreeNode* tree_lookup(Tree *self, const void *key);
+/* out[i] is the node of keys[i] or NULL, the lookups overlap their cache misses */
+size_t tree_lookup_batch(Tree *self, const void * const *keys, size_t nkeys, TreeNode **out);
 Tree* tree_remove(Tree *self, const void *key);
 
 #define tree_output(self, key_str_func, node_str_func...)                        \
@@ -0,0 +1,36 @@
+#ifndef EXTERNALSORT_H_PW3NJQ8D
+#define EXTERNALSORT_H_PW3NJQ8D
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "Base/Definitions.h"
+#include "Utils/Sort.h"
+
+#define EXTERNAL_SORT_DEFAULT_BUDGET ((size_t)256 << 20)
+
+typedef enum
+{
+	EXTERNAL_SORT_DIRECT_IO = 1 << 0 // O_DIRECT for the run files, ignored where the file system can't do it
+} ExternalSortFlags;
+
+/* Gets the sorted records in order, returning false stops the sort */
+typedef bool (*ExternalSortOutputFunc)(const void *records, size_t count, void *userdata);
+
+typedef struct
+{
+	size_t elemsize;
+	CmpFunc cmp_func;       // Merges the runs, and sorts them if key_width is 0
+	size_t key_offset;      // Nonzero key_width: the runs are sorted by radix_sort(),
+	size_t key_width;       // which must agree with cmp_func
+	RadixFlags radix_flags;
+	size_t memory_budget;   // Bytes, 0 means EXTERNAL_SORT_DEFAULT_BUDGET
+	const char *tmp_dir;    // Of the run files, NULL means $TMPDIR or /tmp
+	ExternalSortFlags flags;
+} ExternalSortParams;
+
+/* Reads the fixed-size records from in_fd up to the end of file */
+bool external_sort(int in_fd, int out_fd, const ExternalSortParams *params);
+bool external_sort_with_func(int in_fd, const ExternalSortParams *params, ExternalSortOutputFunc func, void *userdata);
+
+#endif /* end of include guard: EXTERNALSORT_H_PW3NJQ8D */
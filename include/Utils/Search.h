@@ -2,10 +2,136 @@
 #define SEARCH_H_SZMXDFHI
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "Base/Definitions.h"
 
 bool linear_search(void *mass, const void* target, size_t len, size_t elemsize, CmpFunc cmp_func, size_t *index);
 bool binary_search(void *mass, const void* target, size_t left, size_t right, size_t elemsize, CmpFunc cmp_func, size_t *index);
 
+/* mass is sorted by cmp_func, the results are the insertion points */
+size_t lower_bound(const void *mass, const void *target, size_t len, size_t elemsize, CmpFunc cmp_func);
+size_t upper_bound(const void *mass, const void *target, size_t len, size_t elemsize, CmpFunc cmp_func);
+void equal_range(const void *mass, const void *target, size_t len, size_t elemsize, CmpFunc cmp_func,
+                 size_t *first, size_t *last);
+
+/* Type of the key inside the element for the typed scans */
+typedef enum
+{
+	SEARCH_KEY_NONE = 0,
+	SEARCH_KEY_INT8,
+	SEARCH_KEY_UINT8,
+	SEARCH_KEY_INT16,
+	SEARCH_KEY_UINT16,
+	SEARCH_KEY_INT32,
+	SEARCH_KEY_UINT32,
+	SEARCH_KEY_INT64,
+	SEARCH_KEY_UINT64,
+	SEARCH_KEY_FLOAT,
+	SEARCH_KEY_DOUBLE
+} SearchKeyType;
+
+/* Kernels of the typed scans, AUTO takes the best one of the CPU */
+typedef enum
+{
+	SEARCH_ISA_AUTO = 0,
+	SEARCH_ISA_SCALAR,
+	SEARCH_ISA_SSE2,
+	SEARCH_ISA_AVX2
+} SearchIsa;
+
+/* SIMD scans of the keys at key_offset of every element (see Utils/SearchScan.c), the results are indices or len */
+size_t search_key_size(SearchKeyType key_type);
+size_t linear_find_typed(const void *mass, size_t len, size_t elemsize, size_t key_offset,
+                         SearchKeyType key_type, const void *key);
+size_t linear_find_ge_typed(const void *mass, size_t len, size_t elemsize, size_t key_offset,
+                            SearchKeyType key_type, const void *key);
+size_t linear_count_typed(const void *mass, size_t len, size_t elemsize, size_t key_offset,
+                          SearchKeyType key_type, const void *key);
+/* Forces the kernel for the tests and benchmarks, false if the CPU doesn't have it */
+bool search_scan_set_isa(SearchIsa isa);
+
+/* Index of the key, which isn't in mass, for the batched searches */
+#define SEARCH_NOT_FOUND ((size_t) -1)
+
+/* The keys go in the groups of SEARCH_BATCH_GROUP, their cache misses overlap */
+#define SEARCH_BATCH_GROUP 16
+
+size_t binary_search_batch(const void *mass, const void *keys, size_t len, size_t nkeys, size_t elemsize,
+                           CmpFunc cmp_func, size_t *indices);
+
+/* Static copy of the keys in the Eytzinger (BFS) order for the repeated lookups */
+typedef struct
+{
+	char *keys;    // keys[1..len], aligned to SEARCH_INDEX_ALIGN
+	size_t *index; // The position in the original mass of every key
+	size_t len;
+	size_t elemsize;
+	unsigned prefetch_shift; // The levels, whose descendants share a cache line
+	CmpFunc cmp_func;
+} SearchIndex;
+
+#define SEARCH_INDEX_ALIGN 64
+
+/* mass needn't be sorted, the equal keys are found at their first position */
+bool search_index_build(SearchIndex *self, const void *mass, size_t len, size_t elemsize, CmpFunc cmp_func);
+bool search_index_lookup(const SearchIndex *self, const void *target, size_t *index);
+size_t search_index_lower_bound(const SearchIndex *self, const void *target);
+void search_index_clear(SearchIndex *self);
+
+/*
+ * Generates the branchless searches for the concrete key type:
+ *
+ *   lower_bound_##suffix(const type *mass, size_t len, type key)
+ *   upper_bound_##suffix(const type *mass, size_t len, type key)
+ *
+ * less_expr is an expression of 'a' and 'b', which is true if 'a' goes before 'b'.
+ */
+#define SEARCH_DEFINE(suffix, type, less_expr)                                                   \
+	static inline bool search_less_##suffix(type a, type b)                                      \
+	{                                                                                            \
+		return (less_expr);                                                                      \
+	}                                                                                            \
+	static inline size_t lower_bound_##suffix(const type *mass, size_t len, type key)            \
+	{                                                                                            \
+		if (len == 0)                                                                            \
+			return 0;                                                                            \
+                                                                                                 \
+		const type *base = mass;                                                                 \
+                                                                                                 \
+		while (len > 1)                                                                          \
+		{                                                                                        \
+			size_t half = len >> 1;                                                              \
+			__builtin_prefetch(base + ((len - half) >> 1));                                      \
+			__builtin_prefetch(base + half + ((len - half) >> 1));                               \
+			base = (search_less_##suffix(base[half], key)) ? (base + half) : (base);             \
+			len -= half;                                                                         \
+		}                                                                                        \
+                                                                                                 \
+		return (size_t) (base - mass) + search_less_##suffix(*base, key);                        \
+	}                                                                                            \
+	static inline size_t upper_bound_##suffix(const type *mass, size_t len, type key)            \
+	{                                                                                            \
+		if (len == 0)                                                                            \
+			return 0;                                                                            \
+                                                                                                 \
+		const type *base = mass;                                                                 \
+                                                                                                 \
+		while (len > 1)                                                                          \
+		{                                                                                        \
+			size_t half = len >> 1;                                                              \
+			__builtin_prefetch(base + ((len - half) >> 1));                                      \
+			__builtin_prefetch(base + half + ((len - half) >> 1));                               \
+			base = (!search_less_##suffix(key, base[half])) ? (base + half) : (base);            \
+			len -= half;                                                                         \
+		}                                                                                        \
+                                                                                                 \
+		return (size_t) (base - mass) + !search_less_##suffix(key, *base);                       \
+	}
+
+SEARCH_DEFINE(i32, int32_t, a < b)
+SEARCH_DEFINE(i64, int64_t, a < b)
+SEARCH_DEFINE(u32, uint32_t, a < b)
+SEARCH_DEFINE(u64, uint64_t, a < b)
+
 #endif /* end of include guard: SEARCH_H_SZMXDFHI */
@@ -2,10 +2,105 @@
 #define SORT_H_KRWPHNRW
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include "Base/Definitions.h"
+#include "Utils/Search.h"
+
+/* Type of the key, when the elements are the keys themselves */
+typedef enum
+{
+	SORT_KEY_INT32,
+	SORT_KEY_INT64,
+	SORT_KEY_UINT64,
+	SORT_KEY_DOUBLE,
+	SORT_KEY_PTR
+} SortKeyType;
+
+/* Flags of radix_sort(), keys are unsigned by default */
+typedef enum
+{
+	RADIX_UNSIGNED = 0,
+	RADIX_SIGNED = 1 << 0,   // Two's complement integer keys
+	RADIX_FLOAT = 1 << 1,    // IEEE 754 float (4 bytes) or double (8 bytes) keys
+	RADIX_IN_PLACE = 1 << 2, // MSD American flag sort: no buffer, but not stable
+	RADIX_DIGIT_8 = 1 << 3,  // Digit width of the LSD passes, chosen by the length by default
+	RADIX_DIGIT_11 = 1 << 4,
+	RADIX_DIGIT_16 = 1 << 5
+} RadixFlags;
+
+/* The greatest length for sort_small_*() */
+#define SORT_SMALL_MAX 64
+
+/* Kernels of sort_small_*(), AUTO takes the best one of the CPU */
+typedef enum
+{
+	SORT_ISA_AUTO = 0,
+	SORT_ISA_SCALAR,
+	SORT_ISA_SSE41,
+	SORT_ISA_AVX2
+} SortIsa;
+
+/* Below this length parallel_sort() is sequential */
+#define PARALLEL_SORT_THRESHOLD (1 << 16)
+
+typedef enum
+{
+	PARALLEL_SORT_STABLE = 1 << 0 // Equal elements keep their order, needs a buffer of the same length
+} ParallelSortFlags;
+
+/* Accumulates the first k of the elements pushed one at a time, in the order of cmp_func */
+typedef struct
+{
+	char *mass; // Max-heap of the k elements, once it's full
+	size_t len;
+	size_t k;
+	size_t elemsize;
+	CmpFunc cmp_func;
+} TopK;
 
 void inssort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func);
 void heapsort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func);
 void quicksort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func);
 
+size_t* argsort(const void *mass, size_t len, size_t elemsize, CmpFunc cmp_func);
+bool permute_apply(void *mass, size_t len, size_t elemsize, const size_t *perm);
+bool sort_indirect(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func);
+
+void select_nth(void *mass, size_t len, size_t elemsize, size_t k, CmpFunc cmp_func);
+void partial_sort(void *mass, size_t len, size_t elemsize, size_t k, CmpFunc cmp_func);
+
+bool topk_init(TopK *self, size_t k, size_t elemsize, CmpFunc cmp_func);
+void topk_push(TopK *self, const void *elem);
+void* topk_finish(TopK *self, size_t *len);
+void topk_clear(TopK *self);
+
+/* Instances of SORT_DEFINE (see Utils/SortTemplate.h) */
+void sort_int32(int32_t *mass, size_t len);
+void sort_int64(int64_t *mass, size_t len);
+void sort_uint64(uint64_t *mass, size_t len);
+void sort_double(double *mass, size_t len);
+void sort_ptr(void **mass, size_t len);
+
+/* Stable, adaptive to the natural runs, comparisons is the number of the cmp_func calls (may be NULL) */
+bool powersort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func, size_t *comparisons);
+
+/* Sorting networks (SIMD when the CPU has them), len <= SORT_SMALL_MAX */
+void sort_small_i32(int32_t *mass, size_t len);
+void sort_small_i64(int64_t *mass, size_t len);
+void sort_small_f32(float *mass, size_t len);
+/* Forces the kernel for the tests and benchmarks, false if the CPU doesn't have it */
+bool sort_small_set_isa(SortIsa isa);
+
+bool radix_sort(void *mass, size_t len, size_t elemsize, size_t key_offset, size_t key_width, RadixFlags flags);
+
+/* workers == 0 means the number of the online CPUs */
+bool parallel_sort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func, size_t workers, ParallelSortFlags flags);
+size_t parallel_sort_get_default_workers(void);
+
+size_t sort_key_size(SortKeyType key_type);
+bool sort_typed(void *mass, size_t len, SortKeyType key_type);
+/* Records by the key at key_offset, with the typed kernels instead of a CmpFunc */
+bool sort_by_typed_key(void *mass, size_t len, size_t elemsize, size_t key_offset, SearchKeyType key_type);
+
 #endif /* end of include guard: SORT_H_KRWPHNRW */
@@ -0,0 +1,150 @@
+#ifndef SORTTEMPLATE_H_QX4MZB7T
+#define SORTTEMPLATE_H_QX4MZB7T
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "Base/Macros.h"
+#include "Base/Definitions.h"
+
+#define SORT_TEMPLATE_THRESHOLD 16
+
+/*
+ * Generates the sorting functions for the concrete element type:
+ *
+ *   name##_inssort(type *mass, size_t len)
+ *   name##_heapsort(type *mass, size_t len)
+ *   name##_introsort(type *mass, size_t len)
+ *
+ * less_expr is an expression of the two elements 'a' and 'b' (passed by value),
+ * which is true if 'a' goes before 'b'. Everything is inlined, so there are
+ * no indirect calls, and the elements are moved as values of their type.
+ */
+#define SORT_DEFINE(name, type, less_expr)                                             \
+	SORT_DEFINE_WITH_BASE(name, type, less_expr, SORT_TEMPLATE_THRESHOLD, name##_inssort)
+
+/*
+ * The same, but introsort leaves the partitions of up to threshold elements
+ * to base_sort(type *mass, size_t len) instead of the insertion sort.
+ */
+#define SORT_DEFINE_WITH_BASE(name, type, less_expr, threshold, base_sort)             \
+	GNUC_UNUSED static inline bool name##_less(type a, type b)                         \
+	{                                                                                  \
+		return (less_expr);                                                            \
+	}                                                                                  \
+	GNUC_UNUSED static inline void name##_inssort(type *mass, size_t len)              \
+	{                                                                                  \
+		for (size_t i = 1; i < len; ++i)                                               \
+		{                                                                              \
+			type cur = mass[i];                                                        \
+			size_t j = i;                                                              \
+                                                                                       \
+			for (; j > 0 && name##_less(cur, mass[j - 1]); --j)                        \
+				mass[j] = mass[j - 1];                                                 \
+                                                                                       \
+			mass[j] = cur;                                                             \
+		}                                                                              \
+	}                                                                                  \
+	GNUC_UNUSED static inline void name##_sift_down(type *mass, size_t root, size_t len) \
+	{                                                                                  \
+		type value = mass[root];                                                       \
+		size_t child;                                                                  \
+                                                                                       \
+		while ((child = (root << 1) + 1) < len)                                        \
+		{                                                                              \
+			if (child + 1 < len && name##_less(mass[child], mass[child + 1]))          \
+				child++;                                                               \
+                                                                                       \
+			if (!name##_less(value, mass[child]))                                      \
+				break;                                                                 \
+                                                                                       \
+			mass[root] = mass[child];                                                  \
+			root = child;                                                              \
+		}                                                                              \
+                                                                                       \
+		mass[root] = value;                                                            \
+	}                                                                                  \
+	GNUC_UNUSED static void name##_heapsort(type *mass, size_t len)                    \
+	{                                                                                  \
+		if (len <= 1)                                                                  \
+			return;                                                                    \
+                                                                                       \
+		for (size_t i = len >> 1; i-- > 0;)                                            \
+			name##_sift_down(mass, i, len);                                            \
+                                                                                       \
+		for (size_t end = len - 1; end > 0; --end)                                     \
+		{                                                                              \
+			type tmp = mass[0];                                                        \
+			mass[0] = mass[end];                                                       \
+			mass[end] = tmp;                                                           \
+			name##_sift_down(mass, 0, end);                                            \
+		}                                                                              \
+	}                                                                                  \
+	GNUC_UNUSED static inline void name##_swap(type *a, type *b)                       \
+	{                                                                                  \
+		type tmp = *a;                                                                 \
+		*a = *b;                                                                       \
+		*b = tmp;                                                                      \
+	}                                                                                  \
+	GNUC_UNUSED static void name##_introsort_loop(type *mass, size_t len, int depth)   \
+	{                                                                                  \
+		while (len > (threshold))                                                      \
+		{                                                                              \
+			if (depth-- == 0)                                                          \
+			{                                                                          \
+				name##_heapsort(mass, len);                                            \
+				return;                                                                \
+			}                                                                          \
+                                                                                       \
+			/* Median of three, the first and the last are the sentinels */            \
+			size_t mid = len >> 1;                                                     \
+                                                                                       \
+			if (name##_less(mass[mid], mass[0]))                                       \
+				name##_swap(&mass[mid], &mass[0]);                                     \
+			if (name##_less(mass[len - 1], mass[mid]))                                 \
+			{                                                                          \
+				name##_swap(&mass[len - 1], &mass[mid]);                               \
+				if (name##_less(mass[mid], mass[0]))                                   \
+					name##_swap(&mass[mid], &mass[0]);                                 \
+			}                                                                          \
+                                                                                       \
+			type pivot = mass[mid];                                                    \
+			size_t i = 0;                                                              \
+			size_t j = len - 1;                                                        \
+                                                                                       \
+			while (1)                                                                  \
+			{                                                                          \
+				while (name##_less(mass[++i], pivot));                                 \
+				while (name##_less(pivot, mass[--j]));                                 \
+                                                                                       \
+				if (i >= j)                                                            \
+					break;                                                             \
+                                                                                       \
+				name##_swap(&mass[i], &mass[j]);                                       \
+			}                                                                          \
+                                                                                       \
+			/* [0, i) and [i, len), the smaller part is sorted recursively */          \
+			if (i < len - i)                                                           \
+			{                                                                          \
+				name##_introsort_loop(mass, i, depth);                                 \
+				mass += i;                                                             \
+				len -= i;                                                              \
+			}                                                                          \
+			else                                                                       \
+			{                                                                          \
+				name##_introsort_loop(mass + i, len - i, depth);                       \
+				len = i;                                                               \
+			}                                                                          \
+		}                                                                              \
+                                                                                       \
+		base_sort(mass, len);                                                          \
+	}                                                                                  \
+	GNUC_UNUSED static void name##_introsort(type *mass, size_t len)                   \
+	{                                                                                  \
+		if (len <= 1)                                                                  \
+			return;                                                                    \
+                                                                                       \
+		name##_introsort_loop(mass, len, 2 * (ULONG_BIT - __builtin_clzl(len)));       \
+	}
+
+#endif /* end of include guard: SORTTEMPLATE_H_QX4MZB7T */
@@ -0,0 +1,250 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Base.h"
+#include "Base/Arena.h"
+
+/* Predefinitions {{{ */
+
+typedef struct _ArenaChunk ArenaChunk;
+
+struct _ArenaChunk
+{
+	ArenaChunk *next;
+	size_t size;
+	max_align_t data[];
+};
+
+struct _Arena
+{
+	Object parent;
+	ArenaChunk *chunks; // The current chunk is the first one
+	size_t chunk_size;
+	size_t used;
+	char *cur;
+	char *end;
+	char *last; // The last allocation, it can be grown in place
+};
+
+DEFINE_TYPE(Arena, arena, object);
+
+#define ARENA_ALIGN (sizeof(max_align_t))
+#define align_up(v) (((v) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+/* }}} */
+
+/* Private methods {{{ */
+
+static Arena* _Arena_grow(Arena *self, size_t size)
+{
+	size_t chunk_size = (size > self->chunk_size) ? size : self->chunk_size;
+
+	ArenaChunk *chunk = (ArenaChunk*)malloc(sizeof(ArenaChunk) + chunk_size);
+
+	if (chunk == NULL)
+	{
+		msg_error("couldn't allocate memory for arena chunk!");
+		return NULL;
+	}
+
+	chunk->size = chunk_size;
+	chunk->next = self->chunks;
+	self->chunks = chunk;
+
+	self->cur = (char*) chunk->data;
+	self->end = self->cur + chunk_size;
+
+	return self;
+}
+
+static void _Arena_free_chunks(ArenaChunk *chunk)
+{
+	while (chunk != NULL) 
+	{
+		ArenaChunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+}
+
+/* }}} */
+
+/* Public methods {{{ */
+
+static Object* Arena_ctor(Object *_self, va_list *ap)
+{
+	Arena *self = ARENA(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
+
+	size_t chunk_size = va_arg(*ap, size_t);
+
+	self->chunk_size = align_up((chunk_size == 0) ? ARENA_CHUNK_SIZE : chunk_size);
+	self->chunks = NULL;
+	self->cur = NULL;
+	self->end = NULL;
+	self->last = NULL;
+	self->used = 0;
+
+	return _self;
+}
+
+static Object* Arena_dtor(Object *_self, va_list *ap)
+{
+	Arena *self = ARENA(_self);
+
+	_Arena_free_chunks(self->chunks);
+	self->chunks = NULL;
+
+	return _self;
+}
+
+static Object* Arena_cpy(const Object *_self, Object *_object, va_list *ap)
+{
+	msg_warn("arena can't be copied!");
+	return NULL;
+}
+
+static void* Arena_alloc(Arena *self, size_t size)
+{
+	size = align_up((size == 0) ? 1 : size);
+
+	if (self->cur == NULL || (size_t) (self->end - self->cur) < size)
+	{
+		self = _Arena_grow(self, size);
+		return_val_if_fail(self != NULL, NULL);
+	}
+
+	void *result = self->cur;
+
+	self->last = self->cur;
+	self->cur += size;
+	self->used += size;
+
+	memset(result, 0, size);
+
+	return result;
+}
+
+static void* Arena_realloc(Arena *self, void *ptr, size_t old_size, size_t new_size)
+{
+	if (ptr == NULL)
+		return Arena_alloc(self, new_size);
+
+	if (new_size <= old_size)
+		return ptr;
+
+	if (ptr == self->last)
+	{
+		size_t old_aligned = align_up(old_size);
+		size_t new_aligned = align_up(new_size);
+
+		if ((size_t) (self->end - self->last) >= new_aligned)
+		{
+			memset(self->last + old_aligned, 0, new_aligned - old_aligned);
+			self->cur = self->last + new_aligned;
+			self->used += new_aligned - old_aligned;
+
+			return ptr;
+		}
+	}
+
+	void *result = Arena_alloc(self, new_size);
+	return_val_if_fail(result != NULL, NULL);
+
+	memcpy(result, ptr, old_size);
+
+	return result;
+}
+
+static void Arena_reset(Arena *self)
+{
+	if (self->chunks == NULL)
+		return;
+
+	/* Keep one chunk of the default size for reuse */
+	ArenaChunk *keep = NULL;
+	ArenaChunk *chunk = self->chunks;
+
+	while (chunk != NULL) 
+	{
+		ArenaChunk *next = chunk->next;
+
+		if (keep == NULL && chunk->size == self->chunk_size)
+			keep = chunk;
+		else
+			free(chunk);
+
+		chunk = next;
+	}
+
+	self->chunks = keep;
+	self->last = NULL;
+	self->used = 0;
+
+	if (keep != NULL)
+	{
+		keep->next = NULL;
+		self->cur = (char*) keep->data;
+		self->end = self->cur + keep->size;
+	}
+	else
+	{
+		self->cur = NULL;
+		self->end = NULL;
+	}
+}
+
+/* }}} */
+
+/* Selectors {{{ */
+
+Arena* arena_new(size_t chunk_size)
+{
+	return (Arena*)object_new(ARENA_TYPE, chunk_size);
+}
+
+void arena_delete(Arena *self)
+{
+	arg_return_if_fail(IS_ARENA(self));
+	object_delete((Object*) self);
+}
+
+void arena_reset(Arena *self)
+{
+	arg_return_if_fail(IS_ARENA(self));
+	Arena_reset(self);
+}
+
+void* arena_alloc(Arena *self, size_t size)
+{
+	arg_return_val_if_fail(IS_ARENA(self), NULL);
+	return Arena_alloc(self, size);
+}
+
+void* arena_realloc(Arena *self, void *ptr, size_t old_size, size_t new_size)
+{
+	arg_return_val_if_fail(IS_ARENA(self), NULL);
+	return Arena_realloc(self, ptr, old_size, new_size);
+}
+
+size_t arena_get_used(const Arena *self)
+{
+	arg_return_val_if_fail(IS_ARENA(self), 0);
+	return self->used;
+}
+
+/* }}} */
+
+/* Init {{{ */
+
+static void arena_class_init(ArenaClass *klass)
+{
+	OBJECT_CLASS(klass)->ctor = Arena_ctor;
+	OBJECT_CLASS(klass)->dtor = Arena_dtor;
+	OBJECT_CLASS(klass)->cpy = Arena_cpy;
+}
+
+/* }}} */
+
+/* vim: set fdm=marker : */
@@ -20,6 +20,7 @@ struct _InterfaceType
 	InterfaceType **itypes;
 	size_t itypes_count;
 	size_t size;
+	size_t slot;
 };
 
 typedef struct
@@ -39,11 +40,23 @@ typedef struct
 	Interface **ifaces;
 	size_t ifaces_count;
 	size_t size;
+	size_t depth;
+	const ObjectClass **ancestors;
+	Interface **islots;
+	size_t islots_count;
+	ObjectPool *pool;
 } ObjectClassData;
 
 #define oc_data(s) ((ObjectClassData*) (s)->private)
 #define i_data(s) ((InterfaceData*) (s)->private)
 
+/* 
+ * Every interface type gets its own slot at registration,
+ * and every class keeps a flattened table of its interfaces
+ * (including the child ones) indexed by these slots.
+ */
+static size_t interface_slots_count;
+
 /* }}} */
 
 /* Type checking {{{ */
@@ -86,12 +99,21 @@ const Interface* isInterface(const void *_iface)
 	return iface;
 }
 
+static inline Interface* interface_slot(Type _itype, const ObjectClass *klass)
+{
+	const ObjectClassData *kdata = oc_data(klass);
+	size_t slot = ((const InterfaceType*) _itype)->slot;
+
+	return (slot < kdata->islots_count) ? kdata->islots[slot] : NULL;
+}
+
 bool hasInterface(Type itype, const void *self)
 {
 	const ObjectClass *klass = OBJECT_GET_CLASS(self);
-	return_val_if_fail(oc_data(klass)->ifaces != NULL && oc_data(klass)->ifaces_count != 0, false);
+	return_val_if_fail(oc_data(klass)->islots != NULL && oc_data(klass)->islots_count != 0, false);
+	return_val_if_fail(itype != 0, false);
 
-	void *result = interface_find(itype, oc_data(klass)->ifaces, oc_data(klass)->ifaces_count);
+	void *result = interface_slot(itype, klass);
 	return_val_if_fail(result != NULL, false);
 
 	return true;
@@ -100,9 +122,10 @@ bool hasInterface(Type itype, const void *self)
 void* interface_cast(Type itype, const void *self)
 {
 	const ObjectClass *klass = OBJECT_GET_CLASS(self);
-	exit_if_fail(oc_data(klass)->ifaces != NULL && oc_data(klass)->ifaces_count != 0);
+	exit_if_fail(oc_data(klass)->islots != NULL && oc_data(klass)->islots_count != 0);
+	exit_if_fail(itype != 0);
 
-	void *result = interface_find(itype, oc_data(klass)->ifaces, oc_data(klass)->ifaces_count);
+	void *result = interface_slot(itype, klass);
 	exit_if_fail(result != NULL);
 
 	return result;
@@ -243,6 +266,41 @@ void interface_init_all(Interface **ifaces, size_t ifaces_count)
 	}
 }
 
+static void interface_slots_fill(Interface **slots, Interface **ifaces, size_t ifaces_count)
+{
+	for (int i = 0; i < ifaces_count; ++i) 
+	{
+		InterfaceData *idata = i_data(ifaces[i]);
+
+		if (slots[idata->itype->slot] == NULL)
+			slots[idata->itype->slot] = ifaces[i];
+
+		if (idata->ifaces_count != 0 && idata->ifaces != NULL)
+			interface_slots_fill(slots, idata->ifaces, idata->ifaces_count);
+	}
+}
+
+Interface** interface_slots_new(Interface **ifaces, size_t ifaces_count, size_t *slots_count)
+{
+	*slots_count = 0;
+
+	if (ifaces == NULL || ifaces_count == 0)
+		return NULL;
+
+	Interface **slots = (Interface**)calloc(interface_slots_count, sizeof(Interface*));
+
+	if (slots == NULL)
+	{
+		msg_critical("couldn't allocate memory for interface slots!");
+		exit(EXIT_FAILURE);
+	}
+
+	interface_slots_fill(slots, ifaces, ifaces_count);
+	*slots_count = interface_slots_count;
+
+	return slots;
+}
+
 /* }}} */
 
 /* InterfaceType {{{ */
@@ -266,6 +324,7 @@ Type interface_type_new(char *name, size_t size, size_t itypes_count, ...)
 	itype->size = size;
 	itype->itypes_count = itypes_count;
 	itype->itypes = NULL;
+	itype->slot = interface_slots_count++;
 
 	if (itypes_count != 0)
 	{
@@ -2,9 +2,12 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "Base/Messages.h"
-#include "Utils/Stuff.h"
 
 static const char* message_flag_to_color(MessageFlags flag)
 {
@@ -51,70 +54,417 @@ static const char* message_flag_to_prefix(MessageFlags flag, bool *to_stdout)
 	return "";
 }
 
+atomic_int message_level = MESSAGE_DEBUG;
+
+/* The rank is stored, so CRITICAL sets the same level as ERROR */
+void message_set_level(MessageFlags level)
+{
+	atomic_store_explicit(&message_level, message_rank(level), memory_order_relaxed);
+}
+
+MessageFlags message_get_level(void)
+{
+	return atomic_load_explicit(&message_level, memory_order_relaxed);
+}
+
 #if ENABLE_MSG == 0
 
 void message(MessageFlags flag, const char *msg, ...) {};
 void message_func(MessageFlags flag, const char *func, const char *msg, ...) {};
 void return_if_fail_warning(const char* func, const char *expr) {};
 void exit_if_fail_critical(const char* func, const char *expr) {};
+bool message_async_enable(size_t ring_size) { return false; };
+bool message_rate_limit(MessageRateLimit *rl, MessageFlags flag, const char *func) { return false; };
+void message_flush(void) {};
+size_t message_get_dropped(void) { return 0; };
 
 #else
 
-void message(MessageFlags flag, const char *msg, ...)
+/* Async mode {{{ */
+
+/*
+ * Every thread writes its messages into its own ring buffer,
+ * so the producer side is lock-free, and the only consumer is
+ * the drainer thread (or message_flush()), guarded by drain_lock.
+ */
+
+typedef struct
+{
+	MessageFlags flag;
+	char text[MESSAGE_RECORD_LEN];
+} MessageRecord;
+
+typedef struct _MessageRing MessageRing;
+
+struct _MessageRing
+{
+	_Alignas(64) atomic_size_t head; // Written by the owner thread
+	_Alignas(64) atomic_size_t tail; // Written by the consumer
+	atomic_bool dead;
+	size_t mask;
+	MessageRing *next;
+	MessageRecord records[];
+};
+
+static atomic_bool async_enabled;
+static atomic_size_t async_dropped;
+static size_t async_reported;
+static size_t async_ring_size;
+
+static MessageRing *rings;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drain_cond = PTHREAD_COND_INITIALIZER;
+static pthread_key_t ring_key;
+static pthread_t drainer;
+static bool drainer_stop;
+
+static _Thread_local MessageRing *thread_ring;
+static _Thread_local bool thread_released;
+
+static void message_write(MessageFlags flag, const char *text)
 {
-	const char *color;
-	const char *prefix;
-	const char *reset;
 	bool to_stdout;
-	FILE *stream;
 
-	color = message_flag_to_color(flag);
-	prefix = message_flag_to_prefix(flag, &to_stdout);
-	reset = "\033[0m";
+	const char *color = message_flag_to_color(flag);
+	const char *prefix = message_flag_to_prefix(flag, &to_stdout);
+	const char *reset = "\033[0m";
+
+	fprintf((to_stdout) ? stdout : stderr, "** %s%s%s: %s\n", color, prefix, reset, text);
+}
+
+/*
+ * Thread exit: the ring is freed by the consumer, after it's drained.
+ * Messages of the later destructors of the thread are written synchronously.
+ */
+static void message_ring_release(void *ring)
+{
+	thread_ring = NULL;
+	thread_released = true;
+	atomic_store_explicit(&((MessageRing*) ring)->dead, true, memory_order_release);
+}
+
+static MessageRing* message_ring_get(void)
+{
+	if (thread_ring != NULL)
+		return thread_ring;
+
+	if (thread_released)
+		return NULL;
+
+	MessageRing *ring = (MessageRing*)calloc(1, sizeof(MessageRing) + async_ring_size * sizeof(MessageRecord));
+
+	if (ring == NULL)
+		return NULL;
+
+	ring->mask = async_ring_size - 1;
+
+	pthread_mutex_lock(&rings_lock);
+	ring->next = rings;
+	rings = ring;
+	pthread_mutex_unlock(&rings_lock);
+
+	pthread_setspecific(ring_key, ring);
+	thread_ring = ring;
+
+	return ring;
+}
+
+/* Must be called with drain_lock held */
+static void message_drain(void)
+{
+	/* Threads take rings_lock only once, to add their ring */
+	pthread_mutex_lock(&rings_lock);
+
+	MessageRing **link = &rings;
+
+	while (*link != NULL)
+	{
+		MessageRing *ring = *link;
+
+		bool dead = atomic_load_explicit(&ring->dead, memory_order_acquire);
+		size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+		for (; tail != head; ++tail)
+		{
+			MessageRecord *record = &ring->records[tail & ring->mask];
+			message_write(record->flag, record->text);
+		}
+
+		atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+		if (dead)
+		{
+			*link = ring->next;
+			free(ring);
+			continue;
+		}
+
+		link = &ring->next;
+	}
+
+	pthread_mutex_unlock(&rings_lock);
+
+	size_t dropped = atomic_load_explicit(&async_dropped, memory_order_relaxed);
+
+	if (dropped != async_reported)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "%zu messages were dropped!", dropped - async_reported);
+		message_write(MESSAGE_WARNING, text);
+		async_reported = dropped;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+}
+
+static void* message_drainer(void *data)
+{
+	pthread_mutex_lock(&drain_lock);
+
+	while (!drainer_stop)
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+
+		ts.tv_nsec += MESSAGE_DRAIN_INTERVAL_MS * 1000000L;
+		ts.tv_sec += ts.tv_nsec / 1000000000L;
+		ts.tv_nsec %= 1000000000L;
+
+		pthread_cond_timedwait(&drain_cond, &drain_lock, &ts);
+		message_drain();
+	}
+
+	pthread_mutex_unlock(&drain_lock);
+
+	return NULL;
+}
+
+static void message_async_shutdown(void)
+{
+	pthread_mutex_lock(&drain_lock);
+	drainer_stop = true;
+	pthread_cond_signal(&drain_cond);
+	pthread_mutex_unlock(&drain_lock);
+
+	pthread_join(drainer, NULL);
+	atomic_store_explicit(&async_enabled, false, memory_order_release);
+
+	pthread_mutex_lock(&drain_lock);
+	message_drain();
+	pthread_mutex_unlock(&drain_lock);
+}
+
+bool message_async_enable(size_t ring_size)
+{
+	if (atomic_load_explicit(&async_enabled, memory_order_acquire))
+		return true;
+
+	if (ring_size < 2)
+		ring_size = MESSAGE_RING_SIZE;
+
+	/* The ring size has to be a power of two */
+	while (ring_size & (ring_size - 1))
+		ring_size &= ring_size - 1;
+
+	/* Only one caller sets up the key and the drainer */
+	pthread_mutex_lock(&async_lock);
+
+	if (atomic_load_explicit(&async_enabled, memory_order_acquire))
+	{
+		pthread_mutex_unlock(&async_lock);
+		return true;
+	}
+
+	if (pthread_key_create(&ring_key, message_ring_release) != 0)
+	{
+		pthread_mutex_unlock(&async_lock);
+		return false;
+	}
+
+	if (pthread_create(&drainer, NULL, message_drainer, NULL) != 0)
+	{
+		pthread_key_delete(ring_key);
+		pthread_mutex_unlock(&async_lock);
+		return false;
+	}
+
+	async_ring_size = ring_size;
+
+	atexit(message_async_shutdown);
+	atomic_store_explicit(&async_enabled, true, memory_order_release);
+
+	pthread_mutex_unlock(&async_lock);
+
+	return true;
+}
+
+void message_flush(void)
+{
+	if (!atomic_load_explicit(&async_enabled, memory_order_acquire))
+	{
+		fflush(stdout);
+		fflush(stderr);
+		return;
+	}
+
+	pthread_mutex_lock(&drain_lock);
+	message_drain();
+	pthread_mutex_unlock(&drain_lock);
+}
+
+size_t message_get_dropped(void)
+{
+	return atomic_load_explicit(&async_dropped, memory_order_relaxed);
+}
+
+/* }}} */
 
-	if (to_stdout)
-		stream = stdout;
-	else
-		stream = stderr;
+/* Rate limiting {{{ */
+
+static long message_clock_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+bool message_rate_limit(MessageRateLimit *rl, MessageFlags flag, const char *func)
+{
+	long now = message_clock_ms();
+	long stamp = atomic_load_explicit(&rl->stamp, memory_order_relaxed);
+	long refill = (now - stamp) * MESSAGE_RATE_PER_SEC / 1000;
+
+	/* Only the thread, which moved the stamp, refills the bucket */
+	if (refill > 0 && atomic_compare_exchange_strong_explicit(&rl->stamp, &stamp, now,
+				memory_order_relaxed, memory_order_relaxed))
+	{
+		long tokens = atomic_load_explicit(&rl->tokens, memory_order_relaxed);
+		long new_tokens = (tokens + refill > MESSAGE_RATE_BURST) ? MESSAGE_RATE_BURST : tokens + refill;
+
+		atomic_fetch_add_explicit(&rl->tokens, new_tokens - tokens, memory_order_relaxed);
+	}
+
+	if (atomic_fetch_sub_explicit(&rl->tokens, 1, memory_order_relaxed) <= 0)
+	{
+		atomic_fetch_add_explicit(&rl->tokens, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&rl->suppressed, 1, memory_order_relaxed);
+		return false;
+	}
+
+	unsigned long suppressed = atomic_exchange_explicit(&rl->suppressed, 0, memory_order_relaxed);
+
+	if (suppressed != 0)
+		message_func(flag, func, "%lu similar messages were suppressed", suppressed);
+
+	return true;
+}
+
+/* }}} */
+
+static size_t message_format(char *buf, size_t size, const char *func, const char *msg, va_list *ap)
+{
+	int len = 0;
 
+	if (func != NULL)
+		len = snprintf(buf, size, "\033[1;37m%s\033[0m: ", func);
+
+	if (len < 0 || len >= size)
+		return size;
+
+	va_list ap_copy;
+	va_copy(ap_copy, *ap);
+	int msg_len = vsnprintf(buf + len, size - len, msg, ap_copy);
+	va_end(ap_copy);
+
+	return (msg_len < 0) ? len : len + msg_len;
+}
+
+static void message_emit(MessageFlags flag, const char *func, const char *msg, va_list *ap)
+{
+	if (message_rank(flag) > atomic_load_explicit(&message_level, memory_order_relaxed))
+		return;
+
+	if (atomic_load_explicit(&async_enabled, memory_order_acquire))
+	{
+		MessageRing *ring = message_ring_get();
+
+		if (ring != NULL)
+		{
+			size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+			size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+			if (head - tail > ring->mask)
+			{
+				atomic_fetch_add_explicit(&async_dropped, 1, memory_order_relaxed);
+				return;
+			}
+
+			MessageRecord *record = &ring->records[head & ring->mask];
+
+			record->flag = flag;
+
+			/* The record has a fixed size, the cut is marked */
+			if (message_format(record->text, MESSAGE_RECORD_LEN, func, msg, ap) >= MESSAGE_RECORD_LEN)
+				memcpy(record->text + MESSAGE_RECORD_LEN - 4, "...", 4);
+
+			atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+			return;
+		}
+	}
+
+	/* The message is formatted only once, on the stack if it fits */
+	char buf[MESSAGE_RECORD_LEN];
+	size_t len = message_format(buf, sizeof(buf), func, msg, ap);
+
+	if (len < sizeof(buf))
+	{
+		message_write(flag, buf);
+		return;
+	}
+
+	char *text = (char*)malloc(len + 1);
+
+	if (text == NULL)
+	{
+		message_write(flag, buf);
+		return;
+	}
+
+	message_format(text, len + 1, func, msg, ap);
+	message_write(flag, text);
+
+	free(text);
+}
+
+void message(MessageFlags flag, const char *msg, ...)
+{
 	va_list ap;
 	va_start(ap, msg);
-	char *parsed = strdup_vprintf(msg, &ap);
+	message_emit(flag, NULL, msg, &ap);
 	va_end(ap);
-
-	fprintf(stream, "** %s%s%s: %s\n", color, prefix, reset, parsed);
-	free(parsed);
 }
 
 void message_func(MessageFlags flag, const char *func, const char *msg, ...)
 {
 	va_list ap;
 	va_start(ap, msg);
-	char *parsed = strdup_vprintf(msg, &ap);
+	message_emit(flag, func, msg, &ap);
 	va_end(ap);
-
-	const char *white = "\033[1;37m";
-	const char *reset = "\033[0m";
-
-	message(flag, "%s%s%s: %s", white, func, reset, parsed);
-
-	free(parsed);
 }
 
 void return_if_fail_warning(const char* func, const char *expr)
 {
-	const char *white = "\033[1;37m";
-	const char *reset = "\033[0m";
-
-	message(MESSAGE_WARNING, "%s%s%s: assertion '%s' is failed!", white, func, reset, expr);
+	message_func(MESSAGE_WARNING, func, "assertion '%s' is failed!", expr);
 }
 
 void exit_if_fail_critical(const char* func, const char *expr)
 {
-	const char *white = "\033[1;37m";
-	const char *reset = "\033[0m";
-
-	message(MESSAGE_CRITICAL, "%s%s%s: assertion '%s' is failed!", white, func, reset, expr);
+	message_func(MESSAGE_CRITICAL, func, "assertion '%s' is failed!", expr);
 }
 
 #endif
@@ -7,6 +7,8 @@
 #include <signal.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #include "Base.h"
 
@@ -29,8 +31,17 @@ typedef struct
 {
 	unsigned long magic;
 	const ObjectClass *klass;
+	Arena *arena;
+	atomic_size_t refs;
 } ObjectData;
 
+/* Header of the memory block, which can be shared between objects */
+typedef struct
+{
+	atomic_size_t refs;
+	max_align_t data[];
+} SharedBlock;
+
 typedef struct
 {
 	const Object _;
@@ -39,11 +50,17 @@ typedef struct
 	Interface **ifaces;
 	size_t ifaces_count;
 	size_t size;
+	size_t depth;
+	const ObjectClass **ancestors;
+	Interface **islots;
+	size_t islots_count;
+	ObjectPool *pool;
 } ObjectClassData;
 
 #define o_data(s) ((ObjectData*) (s)->private)
 #define oc_data(s) ((ObjectClassData*) (s)->private)
 #define i_data(s) ((InterfaceData*) (s)->private)
+#define s_block(p) ((SharedBlock*) ((char*) (p) - offsetof(SharedBlock, data)))
 
 /* }}} */
 
@@ -53,7 +70,7 @@ const void* isObject(const void *_self)
 {
 	if (_self == NULL)
 	{
-		msg_warn("object is NULL!");
+		msg_warn_limited("object is NULL!");
 		return NULL;
 	}
 
@@ -61,36 +78,39 @@ const void* isObject(const void *_self)
 
 	if (o_data(self)->magic != MAGIC_NUM)
 	{
-		msg_warn("object isn't object!");
+		msg_warn_limited("object isn't object!");
 		return NULL;
 	}
 
 	return self;
 }
 
+/*
+ * Every class keeps the table of its ancestors indexed by depth
+ * (ancestors[0] is always Object and ancestors[depth] is the class itself),
+ * so checking the inheritance is one bounds check and one load.
+ */
+static inline bool class_is_a(const ObjectClass *klass, const ObjectClass *class)
+{
+	const ObjectClassData *kdata = oc_data(klass);
+	size_t depth = oc_data(class)->depth;
+
+	return depth <= kdata->depth && kdata->ancestors[depth] == class;
+}
+
 void* cast(Type _object_type, const void *_self)
 {
-	const Object *object_type = isObject((const Object*) _object_type);
-	exit_if_fail(object_type != NULL);
+	exit_if_fail(_object_type != 0);
 
 	const Object *self = isObject(_self);
 	exit_if_fail(self != NULL);
 
-	if (_object_type != OBJECT_TYPE)
-	{
-		const ObjectClass *p = o_data(self)->klass;
-		const ObjectClass *class = (const ObjectClass*) object_type;
-
-		while (p != class) 
-		{
-			if ((Type) p == OBJECT_TYPE)
-			{
-				msg_critical("object can't be casted to '%s'!", oc_data(class)->name);
-				exit(EXIT_FAILURE);
-			}
+	const ObjectClass *class = (const ObjectClass*) _object_type;
 
-			p = oc_data(p)->super;
-		}
+	if (!class_is_a(o_data(self)->klass, class))
+	{
+		msg_critical("object can't be casted to '%s'!", oc_data(class)->name);
+		exit(EXIT_FAILURE);
 	}
 
 	return (void*) _self;
@@ -100,27 +120,10 @@ bool isOf(const void *_self, Type _object_type)
 {
 	if (_self && _object_type)
 	{
-		const Object *object_type = isObject((const Object*) _object_type);
-		return_val_if_fail(object_type != NULL, 0);
-
 		const Object *self = isObject(_self);
 		return_val_if_fail(self != NULL, 0);
 
-		if (_object_type != OBJECT_TYPE)
-		{
-			const ObjectClass *p = o_data(self)->klass;
-			const ObjectClass *class = (const ObjectClass*) object_type;
-
-			while (p != class) 
-			{
-				if ((Type) p == OBJECT_TYPE)
-					return 0;
-
-				p = oc_data(p)->super;
-			}
-		}
-
-		return 1;
+		return class_is_a(o_data(self)->klass, (const ObjectClass*) _object_type);
 	}
 
 	return 0;
@@ -147,19 +150,25 @@ const char* className(const void *self)
 
 static Object* object_ctor(Object *self, va_list *ap)
 {
-	return_val_if_fail(IS_OBJECT(self), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
+	return self;
+}
+
+static Object* object_ctor_typed(Object *self, const void *params)
+{
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
 	return self;
 }
 
 static Object* object_dtor(Object *self, va_list *ap)
 {
-	return_val_if_fail(IS_OBJECT(self), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
 	return self;
 }
 
 static Object* object_cpy(const Object *self, Object *object, va_list *ap)
 {
-	return_val_if_fail(IS_OBJECT(self), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
 	return object;
 }
 
@@ -180,6 +189,21 @@ static Object* object_class_ctor(Object *_self, va_list *ap)
 	exit_if_fail(IS_OBJECT_CLASS(sdata->super));
 
 	sdata->size = va_arg(*ap, size_t);
+	sdata->pool = NULL;
+
+	ObjectClassData *ssdata = oc_data(sdata->super);
+
+	sdata->depth = ssdata->depth + 1;
+	sdata->ancestors = (const ObjectClass**)calloc(sdata->depth + 1, sizeof(ObjectClass*));
+
+	if (sdata->ancestors == NULL)
+	{
+		msg_critical("couldn't allocate memory for ancestors of class '%s'!", sdata->name);
+		exit(EXIT_FAILURE);
+	}
+
+	memcpy(sdata->ancestors, ssdata->ancestors, sdata->depth * sizeof(ObjectClass*));
+	sdata->ancestors[sdata->depth] = self;
 
 	const size_t offset = offsetof(ObjectClass, ctor);
 	memcpy((char*) self + offset, 
@@ -193,7 +217,12 @@ static Object* object_class_ctor(Object *_self, va_list *ap)
 	if (ic != NULL)
 		ic(self);
 
-	ObjectClassData *ssdata = oc_data(sdata->super);
+	/* 
+	 * The typed ctor of the parent doesn't know about the fields
+	 * of the class, which has its own ctor, but no typed one.
+	 */
+	if (self->ctor != sdata->super->ctor && self->ctor_typed == sdata->super->ctor_typed)
+		self->ctor_typed = NULL;
 
 	size_t ifaces_count = va_arg(*ap, size_t);
 	sdata->ifaces_count = ssdata->ifaces_count + ifaces_count;
@@ -235,6 +264,8 @@ static Object* object_class_ctor(Object *_self, va_list *ap)
 		interface_init_all(sdata->ifaces, sdata->ifaces_count);
 	}
 
+	sdata->islots = interface_slots_new(sdata->ifaces, sdata->ifaces_count, &sdata->islots_count);
+
 	return _self;
 }
 
@@ -261,12 +292,18 @@ static Object* object_class_cpy(const Object *_self, Object *object, va_list *ap
 static const ObjectClass __Object;
 static const ObjectClass __ObjectClass;
 
+static const ObjectClass *__ObjectAncestors[] = { &__Object };
+static const ObjectClass *__ObjectClassAncestors[] = { &__Object, &__ObjectClass };
+
 static const ObjectClass __Object = {
 	{
-		(void*) MAGIC_NUM, (void*) &__ObjectClass,
-		(void*) "Object", (void*) &__Object, (void*) NULL, (void*) 0, (void*) sizeof(Object)
+		(void*) MAGIC_NUM, (void*) &__ObjectClass, (void*) NULL, (void*) 1,
+		(void*) "Object", (void*) &__Object, (void*) NULL, (void*) 0, (void*) sizeof(Object),
+		(void*) 0, (void*) __ObjectAncestors, (void*) NULL, (void*) 0,
+		(void*) NULL
 	},
 	object_ctor,
+	object_ctor_typed,
 	object_dtor,
 	object_cpy,
 	NULL,
@@ -275,10 +312,13 @@ static const ObjectClass __Object = {
 
 static const ObjectClass __ObjectClass = {
 	{
-		(void*) MAGIC_NUM, (void*) &__ObjectClass,
-		(void*) "ObjectClass", (void*) &__Object, (void*) NULL, (void*) 0, (void*) sizeof(ObjectClass)
+		(void*) MAGIC_NUM, (void*) &__ObjectClass, (void*) NULL, (void*) 1,
+		(void*) "ObjectClass", (void*) &__Object, (void*) NULL, (void*) 0, (void*) sizeof(ObjectClass),
+		(void*) 1, (void*) __ObjectClassAncestors, (void*) NULL, (void*) 0,
+		(void*) NULL
 	},
 	object_class_ctor,
+	NULL,
 	object_class_dtor,
 	object_class_cpy,
 	NULL,
@@ -297,12 +337,63 @@ Type object_class_get_type(void)
 
 /* }}} */
 
+/* Type registration {{{ */
+
+/* 
+ * Registering a type registers its parent and interfaces first,
+ * so the lock has to be recursive.
+ */
+static pthread_mutex_t types_mutex;
+static pthread_once_t types_mutex_once = PTHREAD_ONCE_INIT;
+static TypeInitNode *types_init_list;
+
+static void types_mutex_init(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&types_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+void types_lock(void)
+{
+	pthread_once(&types_mutex_once, types_mutex_init);
+	pthread_mutex_lock(&types_mutex);
+}
+
+void types_unlock(void)
+{
+	pthread_mutex_unlock(&types_mutex);
+}
+
+void types_init_register(TypeInitNode *node)
+{
+	types_lock();
+	node->next = types_init_list;
+	types_init_list = node;
+	types_unlock();
+}
+
+void types_init_all(void)
+{
+	types_lock();
+
+	for (TypeInitNode *node = types_init_list; node != NULL; node = node->next) 
+		node->get_type();
+
+	types_unlock();
+}
+
+/* }}} */
+
 /* Selectors {{{ */
 
 
 static Object* ctor(Object *self, va_list *ap)
 {
-	return_val_if_fail(IS_OBJECT(self), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
 
 	const ObjectClass *class = OBJECT_GET_CLASS(self);
 	exit_if_fail(class->ctor != NULL);
@@ -310,9 +401,19 @@ static Object* ctor(Object *self, va_list *ap)
 	return class->ctor(self, ap);
 }
 
+static Object* ctor_typed(Object *self, const void *params)
+{
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
+
+	const ObjectClass *class = OBJECT_GET_CLASS(self);
+	exit_if_fail(class->ctor_typed != NULL);
+
+	return class->ctor_typed(self, params);
+}
+
 static Object* dtor(Object *self, va_list *ap)
 {
-	return_val_if_fail(IS_OBJECT(self), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
 
 	const ObjectClass *class = OBJECT_GET_CLASS(self);
 	exit_if_fail(class->dtor != NULL);
@@ -322,7 +423,7 @@ static Object* dtor(Object *self, va_list *ap)
 
 static Object* cpy(const Object *self, Object *object, va_list *ap)
 {
-	return_val_if_fail(IS_OBJECT(self) && IS_OBJECT(object), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self) && IS_OBJECT(object), NULL);
 
 	const ObjectClass *class = OBJECT_GET_CLASS(self);
 	exit_if_fail(class->cpy != NULL);
@@ -330,15 +431,34 @@ static Object* cpy(const Object *self, Object *object, va_list *ap)
 	return class->cpy(self, object, ap);
 }
 
-Object* object_new(Type object_type, ...)
+static inline Object* object_alloc(const ObjectClassData *cdata, Arena *arena)
 {
-	return_val_if_fail(IS_OBJECT_CLASS(object_type), NULL);
+	if (arena != NULL)
+		return (Object*)arena_alloc(arena, cdata->size);
 
-	const ObjectClass *class = OBJECT_CLASS(object_type);
+	if (cdata->pool != NULL)
+		return (Object*)object_pool_alloc(cdata->pool);
+
+	return (Object*)calloc(1, cdata->size);
+}
+
+static inline void object_free(const ObjectClassData *cdata, Object *object, Arena *arena)
+{
+	if (arena != NULL)
+		return;
+
+	if (cdata->pool != NULL)
+		object_pool_free(cdata->pool, object);
+	else
+		free(object);
+}
+
+static Object* object_instance_new(const ObjectClass *class, Arena *arena)
+{
 	ObjectClassData *cdata = oc_data(class);
 	exit_if_fail(cdata->size != 0);
 
-	Object *object = (Object*)calloc(1, cdata->size);
+	Object *object = object_alloc(cdata, arena);
 
 	if (object == NULL)
 	{
@@ -350,22 +470,83 @@ Object* object_new(Type object_type, ...)
 
 	obdata->magic = MAGIC_NUM;
 	obdata->klass = class;
+	obdata->arena = arena;
+	atomic_init(&obdata->refs, 1);
+
+	return object;
+}
+
+static Object* object_new_valist(Type object_type, Arena *arena, va_list *ap)
+{
+	const ObjectClass *class = OBJECT_CLASS(object_type);
+
+	Object *object = object_instance_new(class, arena);
+
+	if (object == NULL)
+		return NULL;
+
+	object = ctor(object, ap);
+
+	if (object == NULL)
+		msg_error("couldn't create object of type '%s'!", oc_data(class)->name);
+
+	return object;
+}
+
+Object* object_new(Type object_type, ...)
+{
+	arg_return_val_if_fail(IS_OBJECT_CLASS(object_type), NULL);
 
 	va_list ap;
 	va_start(ap, object_type);
-	object = ctor(object, &ap);
+	Object *object = object_new_valist(object_type, NULL, &ap);
 	va_end(ap);
 
+	return object;
+}
+
+Object* object_new_typed(Type object_type, const void *params)
+{
+	arg_return_val_if_fail(IS_OBJECT_CLASS(object_type), NULL);
+
+	const ObjectClass *class = OBJECT_CLASS(object_type);
+
+	if (class->ctor_typed == NULL)
+	{
+		msg_error("type '%s' doesn't have a typed ctor!", oc_data(class)->name);
+		return NULL;
+	}
+
+	Object *object = object_instance_new(class, NULL);
+
 	if (object == NULL)
-		msg_error("couldn't create object of type '%s'!", cdata->name);
+		return NULL;
+
+	object = ctor_typed(object, params);
+
+	if (object == NULL)
+		msg_error("couldn't create object of type '%s'!", oc_data(class)->name);
+
+	return object;
+}
+
+Object* object_new_in(Arena *arena, Type object_type, ...)
+{
+	arg_return_val_if_fail(IS_ARENA(arena), NULL);
+	arg_return_val_if_fail(IS_OBJECT_CLASS(object_type), NULL);
+
+	va_list ap;
+	va_start(ap, object_type);
+	Object *object = object_new_valist(object_type, arena, &ap);
+	va_end(ap);
 
 	return object;
 }
 
 Object* object_new_stack(Type object_type, void *_object, ...)
 {
-	return_val_if_fail(IS_OBJECT_CLASS(object_type), NULL);
-	return_val_if_fail(_object != NULL, NULL);
+	arg_return_val_if_fail(IS_OBJECT_CLASS(object_type), NULL);
+	arg_return_val_if_fail(_object != NULL, NULL);
 
 	const ObjectClass *class = OBJECT_CLASS(object_type);
 	ObjectClassData *cdata = oc_data(class);
@@ -376,6 +557,8 @@ Object* object_new_stack(Type object_type, void *_object, ...)
 
 	obdata->magic = MAGIC_NUM;
 	obdata->klass = class;
+	obdata->arena = NULL;
+	atomic_init(&obdata->refs, 1);
 
 	va_list ap;
 	va_start(ap, _object);
@@ -390,22 +573,27 @@ Object* object_new_stack(Type object_type, void *_object, ...)
 
 void object_delete(Object *self, ...)
 {
-	return_if_fail(IS_OBJECT(self));
+	arg_return_if_fail(IS_OBJECT(self));
+
+	ObjectClassData *cdata = oc_data(OBJECT_GET_CLASS(self));
+	Arena *arena = o_data(self)->arena;
+
 	va_list ap;
 	va_start(ap, self);
-	free(dtor(self, &ap));
+	object_free(cdata, dtor(self, &ap), arena);
 	va_end(ap);
 }
 
 Object* object_copy(const Object *self, ...)
 {
-	return_val_if_fail(IS_OBJECT(self), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
 
 	const ObjectClass *class = OBJECT_GET_CLASS(self);
 	ObjectClassData *cdata = oc_data(class);
 	exit_if_fail(cdata->size != 0);
 
-	Object *object = (Object*)calloc(1, cdata->size);
+	Arena *arena = o_data(self)->arena;
+	Object *object = object_alloc(cdata, arena);
 
 	if (object == NULL)
 	{
@@ -418,6 +606,8 @@ Object* object_copy(const Object *self, ...)
 
 	obdata->magic = MAGIC_NUM;
 	obdata->klass = class;
+	obdata->arena = arena;
+	atomic_init(&obdata->refs, 1);
 
 	va_list ap;
 	va_start(ap, self);
@@ -431,9 +621,32 @@ Object* object_copy(const Object *self, ...)
 	return object;
 }
 
+Object* object_ref(Object *self)
+{
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
+
+	atomic_fetch_add_explicit(&o_data(self)->refs, 1, memory_order_relaxed);
+
+	return self;
+}
+
+void object_unref(Object *self)
+{
+	arg_return_if_fail(IS_OBJECT(self));
+
+	if (atomic_fetch_sub_explicit(&o_data(self)->refs, 1, memory_order_acq_rel) == 1)
+		object_delete(self);
+}
+
+size_t object_get_refcount(const Object *self)
+{
+	arg_return_val_if_fail(IS_OBJECT(self), 0);
+	return atomic_load_explicit(&o_data(self)->refs, memory_order_acquire);
+}
+
 Object* object_set(Object *self, ...)
 {
-	return_val_if_fail(IS_OBJECT(self), NULL);
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
 
 	const ObjectClass *class = OBJECT_GET_CLASS(self);
 	return_val_if_fail(class->set != NULL, NULL);
@@ -448,7 +661,7 @@ Object* object_set(Object *self, ...)
 
 void object_get(const Object *self, ...)
 {
-	return_if_fail(IS_OBJECT(self));
+	arg_return_if_fail(IS_OBJECT(self));
 
 	const ObjectClass *class = OBJECT_GET_CLASS(self);
 	return_if_fail(class->get != NULL);
@@ -459,6 +672,116 @@ void object_get(const Object *self, ...)
 	va_end(ap);
 }
 
+Arena* object_get_arena(const Object *self)
+{
+	arg_return_val_if_fail(IS_OBJECT(self), NULL);
+	return o_data(self)->arena;
+}
+
+void* object_mem_alloc(const Object *self, size_t size)
+{
+	Arena *arena = o_data(self)->arena;
+
+	if (arena != NULL)
+		return arena_alloc(arena, size);
+
+	return calloc(1, size);
+}
+
+void* object_mem_realloc(const Object *self, void *ptr, size_t old_size, size_t new_size)
+{
+	Arena *arena = o_data(self)->arena;
+
+	if (arena != NULL)
+		return arena_realloc(arena, ptr, old_size, new_size);
+
+	return realloc(ptr, new_size);
+}
+
+void object_mem_free(const Object *self, void *ptr)
+{
+	if (o_data(self)->arena == NULL)
+		free(ptr);
+}
+
+void* object_shared_new(const Object *self, size_t size)
+{
+	SharedBlock *block = (SharedBlock*)object_mem_alloc(self, sizeof(SharedBlock) + size);
+	return_val_if_fail(block != NULL, NULL);
+
+	atomic_init(&block->refs, 1);
+
+	return block->data;
+}
+
+void* object_shared_resize(const Object *self, void *ptr, size_t old_size, size_t new_size)
+{
+	if (ptr == NULL)
+		return object_shared_new(self, new_size);
+
+	exit_if_fail(object_shared_is_unique(ptr));
+
+	SharedBlock *block = (SharedBlock*)object_mem_realloc(self, s_block(ptr),
+			sizeof(SharedBlock) + old_size, sizeof(SharedBlock) + new_size);
+	return_val_if_fail(block != NULL, NULL);
+
+	return block->data;
+}
+
+void* object_shared_ref(void *ptr)
+{
+	if (ptr != NULL)
+		atomic_fetch_add_explicit(&s_block(ptr)->refs, 1, memory_order_relaxed);
+
+	return ptr;
+}
+
+bool object_shared_unref(const Object *self, void *ptr)
+{
+	if (ptr == NULL)
+		return true;
+
+	if (atomic_fetch_sub_explicit(&s_block(ptr)->refs, 1, memory_order_acq_rel) != 1)
+		return false;
+
+	object_mem_free(self, s_block(ptr));
+
+	return true;
+}
+
+bool object_shared_is_unique(const void *ptr)
+{
+	if (ptr == NULL)
+		return true;
+
+	return atomic_load_explicit(&s_block(ptr)->refs, memory_order_acquire) == 1;
+}
+
+void object_class_enable_pool(Type object_type)
+{
+	arg_return_if_fail(IS_OBJECT_CLASS(object_type));
+
+	ObjectClassData *cdata = oc_data(OBJECT_CLASS(object_type));
+	exit_if_fail(cdata->size != 0);
+
+	if (cdata->pool == NULL)
+		cdata->pool = object_pool_get(cdata->size);
+}
+
+bool object_pool_stats(Type object_type, size_t *live, size_t *pooled)
+{
+	arg_return_val_if_fail(IS_OBJECT_CLASS(object_type), false);
+
+	ObjectClassData *cdata = oc_data(OBJECT_CLASS(object_type));
+
+	if (cdata->pool == NULL)
+		return false;
+
+	object_pool_get_stats(cdata->pool, live, pooled);
+
+	return true;
+}
+
 /* }}} */
 
 /* vim: set fdm=marker : */
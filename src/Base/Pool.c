@@ -0,0 +1,330 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "Base/Pool.h"
+#include "Base/Messages.h"
+#include "Base/Macros.h"
+
+/* Predefinitions {{{ */
+
+/* The first word of a free block is the link to the next one */
+typedef struct _PoolBlock PoolBlock;
+
+struct _PoolBlock
+{
+	PoolBlock *next;
+};
+
+/* 
+ * Counters of the cache are written only by its thread,
+ * so they are updated without read-modify-write operations
+ * and are summed up only when someone asks for stats.
+ */
+typedef struct
+{
+	PoolBlock *head;
+	atomic_size_t count;
+	atomic_size_t allocs;
+	atomic_size_t frees;
+} PoolCache;
+
+typedef struct _PoolThread PoolThread;
+
+struct _PoolThread
+{
+	PoolCache caches[OBJECT_POOL_MAX];
+	PoolThread *prev;
+	PoolThread *next;
+	bool registered;
+	bool released;
+};
+
+struct _ObjectPool
+{
+	size_t index;
+	size_t size;
+	pthread_mutex_t lock;
+	PoolBlock *spill;
+	size_t spill_count;
+	atomic_size_t allocs;
+	atomic_size_t frees;
+};
+
+static ObjectPool pools[OBJECT_POOL_MAX];
+static size_t pools_count;
+static pthread_mutex_t pools_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static PoolThread *threads;
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t threads_key;
+static pthread_once_t threads_key_once = PTHREAD_ONCE_INIT;
+
+static _Thread_local PoolThread thread;
+
+#define counter_add(c, v) \
+	atomic_store_explicit(&(c), atomic_load_explicit(&(c), memory_order_relaxed) + (v), memory_order_relaxed)
+
+/* }}} */
+
+/* Private methods {{{ */
+
+static void _ObjectPool_spill(ObjectPool *pool, PoolCache *cache, size_t count)
+{
+	pthread_mutex_lock(&pool->lock);
+
+	for (; count != 0 && cache->head != NULL; --count) 
+	{
+		PoolBlock *block = cache->head;
+		cache->head = block->next;
+		counter_add(cache->count, -1);
+
+		if (pool->spill_count >= OBJECT_POOL_SPILL_MAX)
+		{
+			free(block);
+			continue;
+		}
+
+		block->next = pool->spill;
+		pool->spill = block;
+		pool->spill_count++;
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void _ObjectPool_refill(ObjectPool *pool, PoolCache *cache)
+{
+	pthread_mutex_lock(&pool->lock);
+
+	for (size_t i = 0; i < (OBJECT_POOL_CACHE_MAX >> 1) && pool->spill != NULL; ++i) 
+	{
+		PoolBlock *block = pool->spill;
+		pool->spill = block->next;
+		pool->spill_count--;
+
+		block->next = cache->head;
+		cache->head = block;
+		counter_add(cache->count, 1);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Gives the cache of the exiting thread back to the shared pools.
+ * The counters move to the pools under threads_lock, so the stats
+ * never see them twice or not at all. The later destructors of
+ * the thread allocate and free without the cache.
+ */
+static void _PoolThread_release(void *_thread)
+{
+	PoolThread *self = _thread;
+
+	for (size_t i = 0; i < OBJECT_POOL_MAX; ++i) 
+	{
+		PoolCache *cache = &self->caches[i];
+
+		if (cache->head != NULL)
+			_ObjectPool_spill(&pools[i], cache, cache->count);
+	}
+
+	pthread_mutex_lock(&threads_lock);
+
+	for (size_t i = 0; i < OBJECT_POOL_MAX; ++i) 
+	{
+		PoolCache *cache = &self->caches[i];
+
+		atomic_fetch_add_explicit(&pools[i].allocs, cache->allocs, memory_order_relaxed);
+		atomic_fetch_add_explicit(&pools[i].frees, cache->frees, memory_order_relaxed);
+
+		atomic_store_explicit(&cache->allocs, 0, memory_order_relaxed);
+		atomic_store_explicit(&cache->frees, 0, memory_order_relaxed);
+	}
+
+	if (self->prev != NULL)
+		self->prev->next = self->next;
+	else
+		threads = self->next;
+
+	if (self->next != NULL)
+		self->next->prev = self->prev;
+
+	pthread_mutex_unlock(&threads_lock);
+
+	self->registered = false;
+	self->released = true;
+}
+
+static void _PoolThread_key_init(void)
+{
+	pthread_key_create(&threads_key, _PoolThread_release);
+}
+
+static PoolCache* _ObjectPool_cache(ObjectPool *pool)
+{
+	if (thread.released)
+		return NULL;
+
+	if (!thread.registered)
+	{
+		pthread_once(&threads_key_once, _PoolThread_key_init);
+		pthread_setspecific(threads_key, &thread);
+
+		pthread_mutex_lock(&threads_lock);
+
+		thread.prev = NULL;
+		thread.next = threads;
+
+		if (threads != NULL)
+			threads->prev = &thread;
+
+		threads = &thread;
+
+		pthread_mutex_unlock(&threads_lock);
+
+		thread.registered = true;
+	}
+
+	return &thread.caches[pool->index];
+}
+
+/* }}} */
+
+/* Public methods {{{ */
+
+ObjectPool* object_pool_get(size_t size)
+{
+	arg_return_val_if_fail(size >= sizeof(PoolBlock), NULL);
+
+	ObjectPool *result = NULL;
+
+	pthread_mutex_lock(&pools_lock);
+
+	for (size_t i = 0; i < pools_count; ++i) 
+	{
+		if (pools[i].size == size)
+		{
+			result = &pools[i];
+			break;
+		}
+	}
+
+	if (result == NULL && pools_count < OBJECT_POOL_MAX)
+	{
+		result = &pools[pools_count];
+
+		result->index = pools_count;
+		result->size = size;
+		result->spill = NULL;
+		result->spill_count = 0;
+		pthread_mutex_init(&result->lock, NULL);
+
+		pools_count++;
+	}
+
+	pthread_mutex_unlock(&pools_lock);
+
+	if (result == NULL)
+		msg_warn("too many object pools, objects of size %lu won't be pooled!", size);
+
+	return result;
+}
+
+void* object_pool_alloc(ObjectPool *pool)
+{
+	PoolCache *cache = _ObjectPool_cache(pool);
+
+	if (cache == NULL)
+	{
+		void *ptr = calloc(1, pool->size);
+		return_val_if_fail(ptr != NULL, NULL);
+
+		atomic_fetch_add_explicit(&pool->allocs, 1, memory_order_relaxed);
+		return ptr;
+	}
+
+	if (cache->head == NULL)
+		_ObjectPool_refill(pool, cache);
+
+	PoolBlock *block = cache->head;
+
+	if (block == NULL)
+	{
+		block = (PoolBlock*)calloc(1, pool->size);
+		return_val_if_fail(block != NULL, NULL);
+	}
+	else
+	{
+		cache->head = block->next;
+		counter_add(cache->count, -1);
+
+		memset(block, 0, pool->size);
+	}
+
+	counter_add(cache->allocs, 1);
+
+	return block;
+}
+
+void object_pool_free(ObjectPool *pool, void *ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	PoolCache *cache = _ObjectPool_cache(pool);
+	PoolBlock *block = ptr;
+
+	if (cache == NULL)
+	{
+		free(ptr);
+		atomic_fetch_add_explicit(&pool->frees, 1, memory_order_relaxed);
+		return;
+	}
+
+	block->next = cache->head;
+	cache->head = block;
+	counter_add(cache->count, 1);
+	counter_add(cache->frees, 1);
+
+	if (cache->count > OBJECT_POOL_CACHE_MAX)
+		_ObjectPool_spill(pool, cache, OBJECT_POOL_CACHE_MAX >> 1);
+}
+
+void object_pool_get_stats(ObjectPool *pool, size_t *live, size_t *pooled)
+{
+	size_t cached = 0;
+
+	pthread_mutex_lock(&threads_lock);
+
+	size_t allocs = atomic_load_explicit(&pool->allocs, memory_order_relaxed);
+	size_t frees = atomic_load_explicit(&pool->frees, memory_order_relaxed);
+
+	for (PoolThread *t = threads; t != NULL; t = t->next) 
+	{
+		PoolCache *cache = &t->caches[pool->index];
+
+		allocs += atomic_load_explicit(&cache->allocs, memory_order_relaxed);
+		frees += atomic_load_explicit(&cache->frees, memory_order_relaxed);
+		cached += atomic_load_explicit(&cache->count, memory_order_relaxed);
+	}
+
+	pthread_mutex_unlock(&threads_lock);
+
+	pthread_mutex_lock(&pool->lock);
+	cached += pool->spill_count;
+	pthread_mutex_unlock(&pool->lock);
+
+	if (live != NULL)
+		*live = allocs - frees;
+
+	if (pooled != NULL)
+		*pooled = cached;
+}
+
+/* }}} */
+
+/* vim: set fdm=marker : */
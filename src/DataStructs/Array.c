@@ -14,6 +14,10 @@
 
 static void stringer_interface_init(StringerInterface *iface);
 
+/*
+ * The copies share the mass until the first change,
+ * which makes them copy it, if it's still shared.
+ */
 struct _Array
 {
 	Object parent;
@@ -22,6 +26,9 @@ struct _Array
 	size_t capacity;
 	size_t elemsize;
 	size_t len;
+	SearchKeyType key_type;
+	size_t key_offset;
+	CmpFunc sorted_by; // The elements are in its order, NULL if it's unknown
 	bool clear;
 	bool zero_terminated;
 };
@@ -37,6 +44,27 @@ DEFINE_TYPE_WITH_IFACES(Array, array, object, 1,
 
 /* Private methods {{{ */
 
+static Array* _Array_unshare(Array *self)
+{
+	if (object_shared_is_unique(self->mass))
+		return self;
+
+	void *mass = object_shared_new((Object*) self, self->capacity * self->elemsize);
+
+	if (mass == NULL)
+	{
+		msg_error("couldn't allocate memory for array!");
+		return NULL;
+	}
+
+	memcpy(mass, self->mass, self->capacity * self->elemsize);
+	object_shared_unref((Object*) self, self->mass);
+
+	self->mass = mass;
+
+	return self;
+}
+
 static Array* _Array_growcap(Array *self, size_t add)
 {
 	if (add == 0)
@@ -56,7 +84,7 @@ static Array* _Array_growcap(Array *self, size_t add)
 
 	mincap += new_allocated;
 
-	void *mass = (void*)realloc(self->mass, mincap * self->elemsize);
+	void *mass = object_shared_resize((Object*) self, self->mass, self->capacity * self->elemsize, mincap * self->elemsize);
 
 	if (mass == NULL)
 	{
@@ -74,9 +102,43 @@ static Array* _Array_growcap(Array *self, size_t add)
 	return self;
 }
 
+static inline size_t _Array_length(const Array *self)
+{
+	return (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+}
+
+/* The sorted state survives, if the written [index, index + count) keeps the order with its neighbours */
+static void _Array_check_sorted(Array *self, size_t index, size_t count, size_t old_len)
+{
+	if (self->sorted_by == NULL)
+		return;
+
+	/* The elements in the gap aren't in any order */
+	if (index > old_len)
+	{
+		self->sorted_by = NULL;
+		return;
+	}
+
+	size_t len = _Array_length(self);
+	size_t last = (index + count < len) ? (index + count) : (len - 1);
+
+	for (size_t i = (index > 0) ? (index - 1) : (0); i < last; ++i)
+	{
+		if (self->sorted_by(arr_cell(self, i), arr_cell(self, i + 1)) > 0)
+		{
+			self->sorted_by = NULL;
+			return;
+		}
+	}
+}
+
 static Array* _Array_insert(Array *self, size_t index, const void *data)
 {
+	return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
 	int zt = self->zero_terminated;
+	size_t old_len = _Array_length(self);
 
 	if (index + zt >= self->capacity)
 	{
@@ -109,12 +171,17 @@ static Array* _Array_insert(Array *self, size_t index, const void *data)
 	else
 		memcpy(arr_cell(self, index), data, self->elemsize);
 
+	_Array_check_sorted(self, index, 1, old_len);
+
 	return self;
 }
 
 static Array* _Array_insert_many(Array *self, size_t index, const void *data, size_t len)
 {
+	return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
 	int zt = self->zero_terminated;
+	size_t old_len = _Array_length(self);
 
 	if (index + zt + len >= self->capacity)
 	{
@@ -153,6 +220,8 @@ static Array* _Array_insert_many(Array *self, size_t index, const void *data, si
 			memcpy(arr_cell(self, index + i), mass_cell(data, self->elemsize, i), self->elemsize);
 	}
 
+	_Array_check_sorted(self, index, len, old_len);
+
 	return self;
 }
 
@@ -160,19 +229,9 @@ static Array* _Array_insert_many(Array *self, size_t index, const void *data, si
 
 /* Public methods {{{ */
 
-static Object* Array_ctor(Object *_self, va_list *ap)
+static Object* _Array_init(Array *self, const ArrayParams *params)
 {
-	Array *self = ARRAY(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
-
-	bool clear = (bool) va_arg(*ap, int);
-	bool zero_terminated = (bool) va_arg(*ap, int);
-	size_t elemsize = va_arg(*ap, size_t);
-	FreeFunc ff = va_arg(*ap, FreeFunc);
-
-	if (clear)
-		self->mass = calloc(1, elemsize);
-	else
-		self->mass = malloc(elemsize);
+	self->mass = object_shared_new((Object*) self, params->elemsize);
 
 	if (self->mass == NULL)
 	{
@@ -181,15 +240,40 @@ static Object* Array_ctor(Object *_self, va_list *ap)
 		return NULL;
 	}
 
-	self->ff = ff;
-	self->clear = clear;
-	self->zero_terminated = zero_terminated;
-	self->elemsize = elemsize;
+	self->ff = params->free_func;
+	self->clear = params->clear;
+	self->zero_terminated = params->zero_terminated;
+	self->elemsize = params->elemsize;
+	self->key_type = params->key_type;
+	self->key_offset = params->key_offset;
+	self->sorted_by = NULL;
 	self->capacity = 1;
 	
 	self->len = 0;
 
-	return _self;
+	return (Object*) self;
+}
+
+static Object* Array_ctor(Object *_self, va_list *ap)
+{
+	Array *self = ARRAY(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
+
+	ArrayParams params;
+
+	params.clear = (bool) va_arg(*ap, int);
+	params.zero_terminated = (bool) va_arg(*ap, int);
+	params.elemsize = va_arg(*ap, size_t);
+	params.free_func = va_arg(*ap, FreeFunc);
+	params.key_type = SEARCH_KEY_NONE;
+	params.key_offset = 0;
+
+	return _Array_init(self, &params);
+}
+
+static Object* Array_ctor_typed(Object *_self, const void *params)
+{
+	Array *self = ARRAY(OBJECT_CLASS(OBJECT_TYPE)->ctor_typed(_self, params));
+	return _Array_init(self, (const ArrayParams*) params);
 }
 
 static Object* Array_dtor(Object *_self, va_list *ap)
@@ -202,7 +286,7 @@ static Object* Array_dtor(Object *_self, va_list *ap)
 			for (size_t i = 0; i < self->len; ++i) 
 				self->ff(arr_cell(self, i));
 
-		free(self->mass);
+		object_shared_unref((Object*) self, self->mass);
 	}
 
 	return _self;
@@ -213,24 +297,19 @@ static Object* Array_cpy(const Object *_self, Object *_object, va_list *ap)
 	const Array *self = ARRAY(_self);
 	Array *object = ARRAY(OBJECT_CLASS(OBJECT_TYPE)->cpy(_self, _object, ap));
 
-	object->mass = calloc(1, self->capacity * self->elemsize);
-
-	if (object->mass == NULL)
-	{
-		object_delete((Object*) object);
-		msg_error("couldn't allocate memory for the copy of array!");
-		return NULL;
-	}
+	/* The copy lives in the same arena, so it can just share the mass */
+	object->mass = object_shared_ref(self->mass);
 
 	object->clear = self->clear;
 	object->zero_terminated = self->zero_terminated;
 	object->capacity = self->capacity;
 	object->elemsize = self->elemsize;
+	object->key_type = self->key_type;
+	object->key_offset = self->key_offset;
+	object->sorted_by = self->sorted_by;
 
 	object->len = self->len;
 
-	memcpy(object->mass, self->mass, object->len * object->elemsize);
-
 	return _object;
 }
 
@@ -241,7 +320,10 @@ static Object* Array_set(Object *_self, va_list *ap)
 	size_t index = va_arg(*ap, size_t);
 	const void *data = va_arg(*ap, const void*);
 
+	return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
 	int zt = self->zero_terminated;
+	size_t old_len = _Array_length(self);
 
 	if (index + zt >= self->capacity)
 	{
@@ -260,6 +342,8 @@ static Object* Array_set(Object *_self, va_list *ap)
 	if (index + zt >= self->len)
 		self->len = index + zt + 1;
 
+	_Array_check_sorted(self, index, 1, old_len);
+
 	return _self;
 }
 
@@ -274,7 +358,7 @@ static void Array_get(const Object *_self, va_list *ap)
 	
 	if (index >= self->len)
 	{
-		msg_warn("element at [%lu] is out of bounds!", index);
+		msg_warn_limited("element at [%lu] is out of bounds!", index);
 		return;
 	}
 
@@ -341,6 +425,8 @@ static Array* Array_remove_index(Array *self, size_t index)
 		return NULL;
 	}
 
+	return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
 	if (self->ff != NULL)
 		self->ff(*((void**) arr_cell(self, index)));
 
@@ -359,6 +445,8 @@ static void* Array_pop(Array *self)
 	if (self->zero_terminated && self->len < 2)
 		return NULL;
 
+	return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
 	void *ret = malloc(self->elemsize);
 	return_val_if_fail(ret != NULL, NULL);
 
@@ -386,6 +474,8 @@ static Array* Array_remove_range(Array *self, size_t index, size_t len)
 		return NULL;
 	}
 
+	return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
 	if (self->ff != NULL)
 		for (size_t i = index; i < index + len; ++i) 
 			self->ff(arr_cell(self, i));
@@ -400,11 +490,169 @@ static Array* Array_remove_range(Array *self, size_t index, size_t len)
 static void Array_sort(Array *self, CmpFunc cmp_func)
 {
 	if (self->len <= 1)
+	{
+		self->sorted_by = cmp_func;
 		return;
+	}
+
+	return_if_fail(_Array_unshare(self) != NULL);
 
 	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
 
+	/* The keyed arrays are sorted by the key without the calls of cmp_func */
+	if (cmp_func == NULL)
+	{
+		self->sorted_by = NULL;
+		sort_by_typed_key(self->mass, len, self->elemsize, self->key_offset, self->key_type);
+		return;
+	}
+
 	quicksort(self->mass, len, self->elemsize, cmp_func);
+	self->sorted_by = cmp_func;
+}
+
+static void Array_sort_typed(Array *self, SortKeyType key_type)
+{
+	if (self->len <= 1)
+		return;
+
+	return_if_fail(_Array_unshare(self) != NULL);
+
+	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
+
+	self->sorted_by = NULL;
+	sort_typed(self->mass, len, key_type);
+}
+
+static bool Array_sort_stable(Array *self, CmpFunc cmp_func, size_t *comparisons)
+{
+	if (self->len <= 1)
+	{
+		if (comparisons != NULL)
+			*comparisons = 0;
+
+		return true;
+	}
+
+	return_val_if_fail(_Array_unshare(self) != NULL, false);
+
+	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
+
+	if (!powersort(self->mass, len, self->elemsize, cmp_func, comparisons))
+		return false;
+
+	self->sorted_by = cmp_func;
+
+	return true;
+}
+
+static bool Array_sort_by_key(Array *self, size_t key_offset, size_t key_width, RadixFlags flags)
+{
+	if (self->len <= 1)
+		return true;
+
+	return_val_if_fail(_Array_unshare(self) != NULL, false);
+
+	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
+
+	self->sorted_by = NULL;
+
+	return radix_sort(self->mass, len, self->elemsize, key_offset, key_width, flags);
+}
+
+static bool Array_sort_parallel(Array *self, CmpFunc cmp_func, size_t workers, ParallelSortFlags flags)
+{
+	if (self->len <= 1)
+		return true;
+
+	return_val_if_fail(_Array_unshare(self) != NULL, false);
+
+	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
+
+	if (!parallel_sort(self->mass, len, self->elemsize, cmp_func, workers, flags))
+		return false;
+
+	self->sorted_by = cmp_func;
+
+	return true;
+}
+
+static bool Array_sort_indirect(Array *self, CmpFunc cmp_func)
+{
+	if (self->len <= 1)
+		return true;
+
+	return_val_if_fail(_Array_unshare(self) != NULL, false);
+
+	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
+
+	if (!sort_indirect(self->mass, len, self->elemsize, cmp_func))
+		return false;
+
+	self->sorted_by = cmp_func;
+
+	return true;
+}
+
+static size_t* Array_argsort(const Array *self, CmpFunc cmp_func)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+
+	return argsort(self->mass, len, self->elemsize, cmp_func);
+}
+
+static bool Array_permute(Array *self, const size_t *perm)
+{
+	if (self->len <= 1)
+		return true;
+
+	return_val_if_fail(_Array_unshare(self) != NULL, false);
+
+	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
+
+	self->sorted_by = NULL;
+
+	return permute_apply(self->mass, len, self->elemsize, perm);
+}
+
+/* The array is reordered as by select_nth() */
+static bool Array_nth(Array *self, size_t n, CmpFunc cmp_func, void *ret)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+
+	return_val_if_fail(n < len, false);
+	return_val_if_fail(_Array_unshare(self) != NULL, false);
+
+	select_nth(self->mass, len, self->elemsize, n, cmp_func);
+	self->sorted_by = NULL;
+
+	if (ret != NULL)
+		memcpy(ret, arr_cell(self, n), self->elemsize);
+
+	return true;
+}
+
+/* The elements are shallow copies, so the result doesn't free them */
+static Array* Array_top_k(const Array *self, size_t k, CmpFunc cmp_func)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+	TopK topk;
+
+	return_val_if_fail(topk_init(&topk, k, self->elemsize, cmp_func), NULL);
+
+	for (size_t i = 0; i < len; ++i)
+		topk_push(&topk, arr_cell(self, i));
+
+	size_t n;
+	void *mass = topk_finish(&topk, &n);
+	Array *result = array_new(self->clear, self->zero_terminated, self->elemsize, NULL);
+
+	if (result != NULL && n > 0)
+		Array_append_many(result, mass, n);
+
+	free(mass);
+
+	return result;
 }
 
 static bool Array_linear_search(const Array *self, const void *target, CmpFunc cmp_func, size_t *index)
@@ -413,9 +661,40 @@ static bool Array_linear_search(const Array *self, const void *target, CmpFunc c
 		return false;
 
 	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
+
+	/* Without cmp_func the key of the array is compared */
+	if (cmp_func == NULL)
+	{
+		size_t res = linear_find_typed(self->mass, len, self->elemsize, self->key_offset,
+		                               self->key_type, (const char*) target + self->key_offset);
+
+		if (res == len)
+			return false;
+
+		if (index != NULL)
+			*index = res;
+
+		return true;
+	}
+
 	return linear_search(self->mass, target, len, self->elemsize, cmp_func, index);
 }
 
+static size_t Array_count_val(const Array *self, const void *target, CmpFunc cmp_func)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+	size_t count = 0;
+
+	if (cmp_func == NULL)
+		return linear_count_typed(self->mass, len, self->elemsize, self->key_offset,
+		                          self->key_type, (const char*) target + self->key_offset);
+
+	for (size_t i = 0; i < len; ++i)
+		count += (cmp_func(arr_cell(self, i), target) == 0);
+
+	return count;
+}
+
 static bool Array_binary_search(Array *self, const void *target, CmpFunc cmp_func, size_t *index)
 {
 	if (self->len == 0)
@@ -423,33 +702,90 @@ static bool Array_binary_search(Array *self, const void *target, CmpFunc cmp_fun
 
 	size_t len = (self->zero_terminated) ? (self->len - 1) : (self->len);
 
-	if (len < BINARY_SEARCH_LEN_THRESHOLD)
-		return linear_search(self->mass, target, len, self->elemsize, cmp_func, index);
+	/* The array is sorted once, then it stays sorted until a change breaks the order */
+	if (self->sorted_by != cmp_func)
+	{
+		if (len < BINARY_SEARCH_LEN_THRESHOLD)
+			return linear_search(self->mass, target, len, self->elemsize, cmp_func, index);
+
+		Array_sort(self, cmp_func);
+		return_val_if_fail(self->sorted_by == cmp_func, false);
+	}
 
-	quicksort(self->mass, len, self->elemsize, cmp_func);
 	return binary_search(self->mass, target, 0, len - 1, self->elemsize, cmp_func, index);
 }
 
+/* The array has to be sorted by cmp_func, it's not sorted here */
+static size_t Array_lower_bound(const Array *self, const void *target, CmpFunc cmp_func)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+	return lower_bound(self->mass, target, len, self->elemsize, cmp_func);
+}
+
+static size_t Array_upper_bound(const Array *self, const void *target, CmpFunc cmp_func)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+	return upper_bound(self->mass, target, len, self->elemsize, cmp_func);
+}
+
+/* The array has to be sorted by cmp_func, keys is a mass of nkeys elements */
+static size_t Array_search_batch(const Array *self, const void *keys, size_t nkeys, CmpFunc cmp_func, size_t *out_indices)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+	return binary_search_batch(self->mass, keys, len, nkeys, self->elemsize, cmp_func, out_indices);
+}
+
+static bool Array_build_search_index(const Array *self, CmpFunc cmp_func, SearchIndex *index)
+{
+	size_t len = (self->zero_terminated && self->len > 0) ? (self->len - 1) : (self->len);
+	return search_index_build(index, self->mass, len, self->elemsize, cmp_func);
+}
+
 static Array* Array_remove_val(Array *self, const void *target, CmpFunc cmp_func, bool remove_all)
 {
-	bool was_deleted = false;
 	size_t index;
 
-	while (Array_binary_search(self, target, cmp_func, &index)) 
+	if (!Array_binary_search(self, target, cmp_func, &index))
+		return NULL;
+
+	if (remove_all && self->sorted_by == cmp_func)
 	{
-		Array_remove_index(self, index);
-		was_deleted = true;
+		/* The equal elements follow the first one, they go with one move */
+		size_t len = _Array_length(self);
+		size_t count = upper_bound(arr_cell(self, index), target, len - index, self->elemsize, cmp_func);
+
+		return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
+		if (self->ff != NULL)
+			for (size_t i = index; i < index + count; ++i)
+				self->ff(*((void**) arr_cell(self, i)));
+
+		memmove(arr_cell(self, index), arr_cell(self, index + count), (self->len - index - count) * self->elemsize);
+		self->len -= count;
 
-		if (!remove_all)
-			break;
+		return self;
 	}
 
-	if (!was_deleted)
-		return NULL;
+	do
+		Array_remove_index(self, index);
+	while (remove_all && Array_binary_search(self, target, cmp_func, &index));
 
 	return self;
 }
 
+/* The element goes after the equal ones, the array is sorted first, if it isn't yet */
+static Array* Array_insert_sorted(Array *self, const void *data, CmpFunc cmp_func)
+{
+	if (self->sorted_by != cmp_func)
+		Array_sort(self, cmp_func);
+
+	return_val_if_fail(self->sorted_by == cmp_func, NULL);
+
+	size_t index = upper_bound(self->mass, data, _Array_length(self), self->elemsize, cmp_func);
+
+	return _Array_insert(self, index, data);
+}
+
 static Array* Array_unique(Array *self, CmpFunc cmp_func)
 {
 	Array *result = array_new(self->clear, self->zero_terminated, self->elemsize, self->ff);
@@ -467,7 +803,13 @@ static Array* Array_unique(Array *self, CmpFunc cmp_func)
 		return result;
 	}
 
-	quicksort(self->mass, len, self->elemsize, cmp_func);
+	if (_Array_unshare(self) == NULL)
+	{
+		array_delete(result);
+		return NULL;
+	}
+
+	Array_sort(self, cmp_func);
 
 	size_t result_last = 0;
 	Array_append(result, arr_cell(self, 0));
@@ -512,6 +854,8 @@ static void Array_string(const Stringer *_self, va_list *ap)
 
 static void* Array_steal(Array *self, size_t *len)
 {
+	return_val_if_fail(_Array_unshare(self) != NULL, NULL);
+
 	void *ret = calloc(self->len, self->elemsize);
 	return_val_if_fail(ret != NULL, NULL);
 
@@ -532,139 +876,268 @@ static void* Array_steal(Array *self, size_t *len)
 
 Array* array_new(bool clear, bool zero_terminated, size_t elemsize, FreeFunc free_func)
 {
-	return_val_if_fail(elemsize != 0, NULL);
-	return (Array*)object_new(ARRAY_TYPE, clear, zero_terminated, elemsize, free_func);
+	arg_return_val_if_fail(elemsize != 0, NULL);
+	return (Array*)object_new_typed(ARRAY_TYPE, &(ArrayParams) {
+			.clear = clear,
+			.zero_terminated = zero_terminated,
+			.elemsize = elemsize,
+			.free_func = free_func
+	});
+}
+
+/* The linear searches compare the keys of key_type at key_offset of the elements with SIMD */
+Array* array_new_with_key(bool clear, bool zero_terminated, size_t elemsize, FreeFunc free_func,
+                          SearchKeyType key_type, size_t key_offset)
+{
+	arg_return_val_if_fail(elemsize != 0, NULL);
+	arg_return_val_if_fail(key_offset + search_key_size(key_type) <= elemsize, NULL);
+	return (Array*)object_new_typed(ARRAY_TYPE, &(ArrayParams) {
+			.clear = clear,
+			.zero_terminated = zero_terminated,
+			.elemsize = elemsize,
+			.free_func = free_func,
+			.key_type = key_type,
+			.key_offset = key_offset
+	});
 }
 
 Array* array_set(Array *self, size_t index, const void *data)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return (Array*)object_set((Object*) self, index, data);
 }
 
 void array_get(const Array *self, size_t index, void *ret)
 {
-	return_if_fail(IS_ARRAY(self));
-	return_if_fail(ret != NULL);
+	arg_return_if_fail(IS_ARRAY(self));
+	arg_return_if_fail(ret != NULL);
 	object_get((const Object*) self, index, ret);
 }
 
 Array* array_copy(const Array *self)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return (Array*)object_copy((const Object*) self);
 }
 
 void array_delete(Array *self)
 {
-	return_if_fail(IS_ARRAY(self));
+	arg_return_if_fail(IS_ARRAY(self));
 	object_delete((Object*) self);
 }
 
 Array* array_append(Array *self, const void *data)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_append(self, data);
 }
 
 Array* array_prepend(Array *self, const void *data)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_prepend(self, data);
 }
 
 Array* array_insert(Array *self, size_t index, const void *data)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_insert(self, index, data);
 }
 
 Array* array_append_many(Array *self, const void *data, size_t len)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_append_many(self, data, len);
 }
 
 Array* array_prepend_many(Array *self, const void *data, size_t len)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_prepend_many(self, data, len);
 }
 
 Array* array_insert_many(Array *self, size_t index, const void *data, size_t len)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_insert_many(self, index, data, len);
 }
 
 Array* array_remove_index(Array *self, size_t index)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_remove_index(self, index);
 }
 
 Array* array_remove_val(Array *self, const void *target, CmpFunc cmp_func, bool remove_all)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return Array_remove_val(self, target, cmp_func, remove_all);
 }
 
+Array* array_insert_sorted(Array *self, const void *data, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(data != NULL, NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
+	return Array_insert_sorted(self, data, cmp_func);
+}
+
 Array* array_remove_range(Array *self, size_t index, size_t len)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_remove_range(self, index, len);
 }
 
 void array_sort(Array *self, CmpFunc cmp_func)
 {
-	return_if_fail(IS_ARRAY(self));
-	return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(IS_ARRAY(self));
+	arg_return_if_fail(cmp_func != NULL || self->key_type != SEARCH_KEY_NONE);
 	Array_sort(self, cmp_func);
 }
 
+void array_sort_typed(Array *self, SortKeyType key_type)
+{
+	arg_return_if_fail(IS_ARRAY(self));
+	arg_return_if_fail(self->elemsize == sort_key_size(key_type));
+	Array_sort_typed(self, key_type);
+}
+
+bool array_sort_stable(Array *self, CmpFunc cmp_func, size_t *comparisons)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	return Array_sort_stable(self, cmp_func, comparisons);
+}
+
+bool array_sort_by_key(Array *self, size_t key_offset, size_t key_width, RadixFlags flags)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(key_offset + key_width <= self->elemsize, false);
+	return Array_sort_by_key(self, key_offset, key_width, flags);
+}
+
+bool array_sort_parallel(Array *self, CmpFunc cmp_func, size_t workers, ParallelSortFlags flags)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	return Array_sort_parallel(self, cmp_func, workers, flags);
+}
+
+bool array_sort_indirect(Array *self, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	return Array_sort_indirect(self, cmp_func);
+}
+
+size_t* array_argsort(const Array *self, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
+	return Array_argsort(self, cmp_func);
+}
+
+bool array_permute(Array *self, const size_t *perm)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(perm != NULL, false);
+	return Array_permute(self, perm);
+}
+
+bool array_nth(Array *self, size_t n, CmpFunc cmp_func, void *ret)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	return Array_nth(self, n, cmp_func, ret);
+}
+
+Array* array_top_k(const Array *self, size_t k, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
+	return Array_top_k(self, k, cmp_func);
+}
+
 bool array_binary_search(Array *self, const void *target, CmpFunc cmp_func, size_t *index)
 {
-	return_val_if_fail(IS_ARRAY(self), false);
-	return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
 	return Array_binary_search(self, target, cmp_func, index);
 }
 
+ssize_t array_lower_bound(const Array *self, const void *target, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), -1);
+	arg_return_val_if_fail(cmp_func != NULL, -1);
+	return Array_lower_bound(self, target, cmp_func);
+}
+
+ssize_t array_upper_bound(const Array *self, const void *target, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), -1);
+	arg_return_val_if_fail(cmp_func != NULL, -1);
+	return Array_upper_bound(self, target, cmp_func);
+}
+
+size_t array_search_batch(const Array *self, const void *keys, size_t nkeys, CmpFunc cmp_func, size_t *out_indices)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), 0);
+	arg_return_val_if_fail(cmp_func != NULL, 0);
+	return Array_search_batch(self, keys, nkeys, cmp_func, out_indices);
+}
+
+bool array_build_search_index(const Array *self, CmpFunc cmp_func, SearchIndex *index)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(index != NULL, false);
+	return Array_build_search_index(self, cmp_func, index);
+}
+
 bool array_linear_search(const Array *self, const void *target, CmpFunc cmp_func, size_t *index)
 {
-	return_val_if_fail(IS_ARRAY(self), false);
-	return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(IS_ARRAY(self), false);
+	arg_return_val_if_fail(cmp_func != NULL || self->key_type != SEARCH_KEY_NONE, false);
 	return Array_linear_search(self, target, cmp_func, index);
 }
 
+size_t array_count_val(const Array *self, const void *target, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(IS_ARRAY(self), 0);
+	arg_return_val_if_fail(target != NULL, 0);
+	arg_return_val_if_fail(cmp_func != NULL || self->key_type != SEARCH_KEY_NONE, 0);
+	return Array_count_val(self, target, cmp_func);
+}
+
 Array* array_unique(Array *self, CmpFunc cmp_func)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return Array_unique(self, cmp_func);
 }
 
 void* array_steal(Array *self, size_t *len)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_steal(self, len);
 }
 
 ssize_t array_get_length(const Array *self)
 {
-	return_val_if_fail(IS_ARRAY(self), -1);
+	arg_return_val_if_fail(IS_ARRAY(self), -1);
 	return self->len;
 }
 
 void* array_pop(Array *self)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return Array_pop(self);
 }
 
 bool array_is_empty(const Array *self)
 {
-	return_val_if_fail(IS_ARRAY(self), NULL);
+	arg_return_val_if_fail(IS_ARRAY(self), NULL);
 	return (self->len == 0) ? true : false;
 }
 
@@ -680,6 +1153,7 @@ static void stringer_interface_init(StringerInterface *iface)
 static void array_class_init(ArrayClass *klass)
 {
 	OBJECT_CLASS(klass)->ctor = Array_ctor;
+	OBJECT_CLASS(klass)->ctor_typed = Array_ctor_typed;
 	OBJECT_CLASS(klass)->dtor = Array_dtor;
 	OBJECT_CLASS(klass)->set = Array_set;
 	OBJECT_CLASS(klass)->get = Array_get;
@@ -36,8 +36,8 @@ DEFINE_TYPE_WITH_IFACES(BigInt, bi, object, 1,
 #define WORD_MASK (((1U << (WORD_BIT - 1U)) - 1U) * 2U + 1U) // Word mask
 #define WORD_MAX (WORD_MASK)
 #define WORD_BASE (1ULL << WORD_BIT) // Word base
-#define BI_ZERO ((BigInt*)object_new(BIGINT_TYPE, BI_INIT_INT, 0))
-#define BI_ONE ((BigInt*)object_new(BIGINT_TYPE, BI_INIT_INT, 1))
+#define BI_ZERO (bi_new_int(0))
+#define BI_ONE (bi_new_int(1))
 
 #define bi_get_bit(self, bit) (((self)->words[(bit) / WORD_BIT] & (1 << ((bit) % WORD_BIT))) ? 1 : 0)
 
@@ -53,6 +53,28 @@ DEFINE_TYPE_WITH_IFACES(BigInt, bi, object, 1,
 
 /* Private methods {{{ */
 
+/* The copies share the words until one of them is changed */
+static BigInt* _BigInt_unshare(BigInt *self)
+{
+	if (object_shared_is_unique(self->words))
+		return self;
+
+	word_t *words = (word_t*)object_shared_new((Object*) self, self->capacity * sizeof(word_t));
+
+	if (words == NULL)
+	{
+		msg_error("couldn't allocate memory for bigint!");
+		return NULL;
+	}
+
+	memcpy(words, self->words, self->capacity * sizeof(word_t));
+	object_shared_unref((Object*) self, self->words);
+
+	self->words = words;
+
+	return self;
+}
+
 static BigInt* _BigInt_growcap(BigInt *self, size_t add)
 {
 	if (add == 0)
@@ -72,7 +94,8 @@ static BigInt* _BigInt_growcap(BigInt *self, size_t add)
 
 	mincap += new_allocated;
 
-	word_t *words = (word_t*)realloc(self->words, mincap * sizeof(word_t));
+	word_t *words = (word_t*)object_shared_resize((Object*) self, self->words,
+			self->capacity * sizeof(word_t), mincap * sizeof(word_t));
 
 	if (words == NULL)
 	{
@@ -94,7 +117,7 @@ static void _BigInt_clamp(BigInt *self)
 
 static BigInt* _BigInt_add(const BigInt *hi, const BigInt *lo)
 {
-	BigInt *result = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, hi->length + 1);
+	BigInt *result = bi_new_sized(hi->length + 1);
 	return_val_if_fail(result != NULL, NULL);
 
 	word_t carry = 0;
@@ -143,7 +166,7 @@ static BigInt* _BigInt_add(const BigInt *hi, const BigInt *lo)
 
 static BigInt* _BigInt_sub(const BigInt *hi, const BigInt *lo)
 {
-	BigInt *result = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, hi->length);
+	BigInt *result = bi_new_sized(hi->length);
 	return_val_if_fail(result != NULL, NULL);
 
 	word_t carry = 0;
@@ -440,15 +463,13 @@ static BigInt* BigInt_mul_int(const BigInt *a, int b);
 
 /* Base {{{ */
 
-static Object* BigInt_ctor(Object *_self, va_list *ap)
+static Object* _BigInt_init(BigInt *self, const BigIntParams *params)
 {
-	BigInt *self = BIGINT(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
-
-	BigIntInitType type = va_arg(*ap, BigIntInitType);
+	BigIntInitType type = params->init;
 
 	if (type == BI_INIT_SIZED)
 	{
-		size_t numb = va_arg(*ap, size_t);
+		size_t numb = params->size;
 
 		if (numb == 0)
 			self->capacity = 1;
@@ -459,7 +480,7 @@ static Object* BigInt_ctor(Object *_self, va_list *ap)
 		self->capacity = 1;
 
 	self->length = 0;
-	self->words = (word_t*)calloc(self->capacity, sizeof(word_t));
+	self->words = (word_t*)object_shared_new((Object*) self, self->capacity * sizeof(word_t));
 	self->sign = 0;
 
 	if (self->words == NULL)
@@ -474,7 +495,7 @@ static Object* BigInt_ctor(Object *_self, va_list *ap)
 
 	if (type == BI_INIT_INT)
 	{
-		int numb = va_arg(*ap, int);
+		int numb = params->value;
 
 		if (numb != 0)
 		{
@@ -487,8 +508,8 @@ static Object* BigInt_ctor(Object *_self, va_list *ap)
 	}
 	else
 	{
-		char *numb = va_arg(*ap, char*);
-		char *p = numb;
+		const char *numb = params->str;
+		const char *p = numb;
 
 		int sign = 0;
 
@@ -543,12 +564,35 @@ static Object* BigInt_ctor(Object *_self, va_list *ap)
 	return (Object*) self;
 }
 
+static Object* BigInt_ctor(Object *_self, va_list *ap)
+{
+	BigInt *self = BIGINT(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
+
+	BigIntParams params;
+	params.init = va_arg(*ap, BigIntInitType);
+
+	if (params.init == BI_INIT_SIZED)
+		params.size = va_arg(*ap, size_t);
+	else if (params.init == BI_INIT_INT)
+		params.value = va_arg(*ap, int);
+	else
+		params.str = va_arg(*ap, const char*);
+
+	return _BigInt_init(self, &params);
+}
+
+static Object* BigInt_ctor_typed(Object *_self, const void *params)
+{
+	BigInt *self = BIGINT(OBJECT_CLASS(OBJECT_TYPE)->ctor_typed(_self, params));
+	return _BigInt_init(self, (const BigIntParams*) params);
+}
+
 static Object* BigInt_dtor(Object *_self, va_list *ap)
 {
 	BigInt *self = BIGINT(_self);
 
 	if (self->words)
-		free(self->words);
+		object_shared_unref((Object*) self, self->words);
 
 	return _self;
 }
@@ -560,18 +604,9 @@ static Object* BigInt_cpy(const Object *_self, Object *_object, va_list *ap)
 
 	object->capacity = self->capacity;
 	object->length = self->length;
-	object->words = (word_t*)calloc(self->capacity, sizeof(word_t));
+	object->words = (word_t*)object_shared_ref(self->words);
 	object->sign = self->sign;
 
-	if (object->words == NULL)
-	{
-		object_delete((Object*) object);
-		msg_error("couldn't allocate memory for the copy of bi!");
-		return NULL;
-	}
-
-	memcpy(object->words, self->words, self->length * sizeof(word_t));
-
 	return _object;
 }
 
@@ -581,6 +616,8 @@ static Object* BigInt_set(Object *_self, va_list *ap)
 
 	BigIntSetType type = va_arg(*ap, BigIntSetType);
 
+	return_val_if_fail(_BigInt_unshare(self) != NULL, NULL);
+
 	if (type == BI_SET_INT)
 	{
 		int numb = va_arg(*ap, int);
@@ -882,6 +919,9 @@ static BigInt* BigInt_lshift(BigInt *self, size_t shift)
 	size_t wlshift = shift / WORD_BIT;
 	size_t lshift = shift % WORD_BIT;
 
+	self = _BigInt_unshare(self);
+	return_val_if_fail(self != NULL, NULL);
+
 	if (self->length + WORDS(shift) > self->capacity)
 	{
 		self = _BigInt_growcap(self, (self->length + WORDS(shift)) - self->capacity);
@@ -930,6 +970,9 @@ static BigInt* BigInt_rshift(BigInt *self, size_t shift)
 	size_t wrshift = shift / WORD_BIT;
 	size_t rshift = shift % WORD_BIT;
 
+	self = _BigInt_unshare(self);
+	return_val_if_fail(self != NULL, NULL);
+
 	if (wrshift != 0)
 	{
 		if (wrshift >= self->length)
@@ -996,7 +1039,7 @@ static BigInt* BigInt_mul(const BigInt *a, const BigInt *b)
 		lo = a;
 	}
 
-	result = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, hi->length + lo->length);
+	result = bi_new_sized(hi->length + lo->length);
 	return_val_if_fail(result != NULL, NULL);
 
 	result->length = hi->length + lo->length;
@@ -1039,7 +1082,7 @@ static BigInt* BigInt_mul_int(const BigInt *a, int b)
 		return result;
 	}
 
-	result = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, a->length + 1);
+	result = bi_new_sized(a->length + 1);
 	return_val_if_fail(result != NULL, NULL);
 
 	lword_t carry = 0;
@@ -1073,7 +1116,7 @@ static BigInt* BigInt_mul_int(const BigInt *a, int b)
 
 static void BigInt_divrem(const BigInt *dividend, const BigInt *divisor, BigInt **ret_quot, BigInt **ret_rem)
 {
-	BigInt *quot, *rem;
+	BigInt *quot = NULL, *rem = NULL;
 
 	return_if_fail(divisor->length != 0);
 
@@ -1148,10 +1191,10 @@ static void BigInt_divrem(const BigInt *dividend, const BigInt *divisor, BigInt
 	size_t m = dividend->length;
 	size_t n = divisor->length;
 
-	quot = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, m);
+	quot = bi_new_sized(m);
 	return_if_fail(quot != NULL);
 
-	rem = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, m);
+	rem = bi_new_sized(m);
 	if (rem == NULL)
 	{
 		object_delete((Object*) quot);
@@ -1199,7 +1242,7 @@ static void BigInt_divrem(const BigInt *dividend, const BigInt *divisor, BigInt
 
 static void BigInt_divrem_int(const BigInt *dividend, int divisor, BigInt **ret_quot, BigInt **ret_rem)
 {
-	BigInt *quot, *rem;
+	BigInt *quot = NULL, *rem = NULL;
 
 	return_if_fail(divisor != 0);
 
@@ -1270,10 +1313,10 @@ static void BigInt_divrem_int(const BigInt *dividend, int divisor, BigInt **ret_
 
 	size_t m = dividend->length;
 
-	quot = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, m);
+	quot = bi_new_sized(m);
 	return_if_fail(quot != NULL);
 
-	rem = (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, 1);
+	rem = bi_new_sized(1);
 	if (rem == NULL)
 	{
 		object_delete((Object*) quot);
@@ -1316,40 +1359,40 @@ static void BigInt_divrem_int(const BigInt *dividend, int divisor, BigInt **ret_
 
 BigInt* bi_new_str(char *numb)
 {
-	return (BigInt*)object_new(BIGINT_TYPE, BI_INIT_STR, numb);
+	return (BigInt*)object_new_typed(BIGINT_TYPE, &(BigIntParams) { .init = BI_INIT_STR, .str = numb });
 }
 
 BigInt* bi_new_int(int numb)
 {
-	return (BigInt*)object_new(BIGINT_TYPE, BI_INIT_INT, numb);
+	return (BigInt*)object_new_typed(BIGINT_TYPE, &(BigIntParams) { .init = BI_INIT_INT, .value = numb });
 }
 
 BigInt* bi_new_sized(size_t size)
 {
-	return (BigInt*)object_new(BIGINT_TYPE, BI_INIT_SIZED, size);
+	return (BigInt*)object_new_typed(BIGINT_TYPE, &(BigIntParams) { .init = BI_INIT_SIZED, .size = size });
 }
 
 BigInt* bi_copy(const BigInt *self)
 {
-	return_val_if_fail(IS_BIGINT(self), NULL);
+	arg_return_val_if_fail(IS_BIGINT(self), NULL);
 	return (BigInt*)object_copy((const Object*) self);
 }
 
 BigInt* bi_set_int(BigInt *self, int value)
 {
-	return_val_if_fail(IS_BIGINT(self), NULL);
+	arg_return_val_if_fail(IS_BIGINT(self), NULL);
 	return (BigInt*)object_set((Object*) self, BI_SET_INT, value);
 }
 
 BigInt* bi_set_str(BigInt *self, char *value)
 {
-	return_val_if_fail(IS_BIGINT(self), NULL);
+	arg_return_val_if_fail(IS_BIGINT(self), NULL);
 	return (BigInt*)object_set((Object*) self, BI_SET_STR, value);
 }
 
 char* bi_get(const BigInt *self)
 {
-	return_val_if_fail(IS_BIGINT(self), NULL);
+	arg_return_val_if_fail(IS_BIGINT(self), NULL);
 
 	char *ret = NULL;
 	object_get((Object*) self, &ret);
@@ -1360,91 +1403,91 @@ char* bi_get(const BigInt *self)
 
 void bi_delete(BigInt *self)
 {
-	return_if_fail(IS_BIGINT(self));
+	arg_return_if_fail(IS_BIGINT(self));
 	object_delete((Object*) self);
 }
 
 BigInt* bi_lshift(BigInt *self, size_t shift)
 {
-	return_val_if_fail(IS_BIGINT(self), NULL);
+	arg_return_val_if_fail(IS_BIGINT(self), NULL);
 	return BigInt_lshift(self, shift);
 }
 
 BigInt* bi_rshift(BigInt *self, size_t shift)
 {
-	return_val_if_fail(IS_BIGINT(self), NULL);
+	arg_return_val_if_fail(IS_BIGINT(self), NULL);
 	return BigInt_rshift(self, shift);
 }
 
 int bi_cmp(const BigInt *a, const BigInt *b)
 {
-	return_val_if_fail(IS_BIGINT(a), -2);
-	return_val_if_fail(IS_BIGINT(b), -2);
+	arg_return_val_if_fail(IS_BIGINT(a), -2);
+	arg_return_val_if_fail(IS_BIGINT(b), -2);
 	return BigInt_cmp(a, b);
 }
 
 int bi_cmp_int(const BigInt *a, int b)
 {
-	return_val_if_fail(IS_BIGINT(a), -2);
+	arg_return_val_if_fail(IS_BIGINT(a), -2);
 	return BigInt_cmp_int(a, b);
 }
 
 BigInt* bi_add(const BigInt *a, const BigInt *b)
 {
-	return_val_if_fail(IS_BIGINT(a), NULL);
-	return_val_if_fail(IS_BIGINT(b), NULL);
+	arg_return_val_if_fail(IS_BIGINT(a), NULL);
+	arg_return_val_if_fail(IS_BIGINT(b), NULL);
 	return BigInt_add(a, b);
 }
 
 BigInt* bi_add_int(const BigInt *a, int b)
 {
-	return_val_if_fail(IS_BIGINT(a), NULL);
+	arg_return_val_if_fail(IS_BIGINT(a), NULL);
 	return BigInt_add_int(a, b);
 }
 
 BigInt* bi_sub(const BigInt *a, const BigInt *b)
 {
-	return_val_if_fail(IS_BIGINT(a), NULL);
-	return_val_if_fail(IS_BIGINT(b), NULL);
+	arg_return_val_if_fail(IS_BIGINT(a), NULL);
+	arg_return_val_if_fail(IS_BIGINT(b), NULL);
 	return BigInt_sub(a, b);
 }
 
 BigInt* bi_sub_int(const BigInt *a, int b)
 {
-	return_val_if_fail(IS_BIGINT(a), NULL);
+	arg_return_val_if_fail(IS_BIGINT(a), NULL);
 	return BigInt_sub_int(a, b);
 }
 
 BigInt* bi_mul(const BigInt *a, const BigInt *b)
 {
-	return_val_if_fail(IS_BIGINT(a), NULL);
-	return_val_if_fail(IS_BIGINT(b), NULL);
+	arg_return_val_if_fail(IS_BIGINT(a), NULL);
+	arg_return_val_if_fail(IS_BIGINT(b), NULL);
 	return BigInt_mul(a, b);
 }
 
 BigInt* bi_mul_int(const BigInt *a, int b)
 {
-	return_val_if_fail(IS_BIGINT(a), NULL);
+	arg_return_val_if_fail(IS_BIGINT(a), NULL);
 	return BigInt_mul_int(a, b);
 }
 
 void bi_divrem(const BigInt *dividend, const BigInt *divisor, BigInt **quot, BigInt **rem)
 {
-	return_if_fail(IS_BIGINT(dividend));
-	return_if_fail(IS_BIGINT(divisor));
+	arg_return_if_fail(IS_BIGINT(dividend));
+	arg_return_if_fail(IS_BIGINT(divisor));
 	BigInt_divrem(dividend, divisor, quot, rem);
 }
 
 void bi_divrem_int(const BigInt *dividend, int divisor, BigInt **quot, BigInt **rem)
 {
-	return_if_fail(IS_BIGINT(dividend));
+	arg_return_if_fail(IS_BIGINT(dividend));
 	BigInt_divrem_int(dividend, divisor, quot, rem);
 }
 
 BigInt* bi_div(const BigInt *dividend, const BigInt *divisor)
 {
-	return_val_if_fail(IS_BIGINT(dividend), NULL);
-	return_val_if_fail(IS_BIGINT(divisor), NULL);
+	arg_return_val_if_fail(IS_BIGINT(dividend), NULL);
+	arg_return_val_if_fail(IS_BIGINT(divisor), NULL);
 
 	BigInt *quot = NULL; 
 
@@ -1456,7 +1499,7 @@ BigInt* bi_div(const BigInt *dividend, const BigInt *divisor)
 
 BigInt* bi_div_int(const BigInt *dividend, int divisor)
 {
-	return_val_if_fail(IS_BIGINT(dividend), NULL);
+	arg_return_val_if_fail(IS_BIGINT(dividend), NULL);
 
 	BigInt *quot = NULL; 
 
@@ -1468,8 +1511,8 @@ BigInt* bi_div_int(const BigInt *dividend, int divisor)
 
 BigInt* bi_mod(const BigInt *dividend, const BigInt *divisor)
 {
-	return_val_if_fail(IS_BIGINT(dividend), NULL);
-	return_val_if_fail(IS_BIGINT(divisor), NULL);
+	arg_return_val_if_fail(IS_BIGINT(dividend), NULL);
+	arg_return_val_if_fail(IS_BIGINT(divisor), NULL);
 
 	BigInt *rem = NULL;
 
@@ -1481,7 +1524,7 @@ BigInt* bi_mod(const BigInt *dividend, const BigInt *divisor)
 
 BigInt* bi_mod_int(const BigInt *dividend, int divisor)
 {
-	return_val_if_fail(IS_BIGINT(dividend), NULL);
+	arg_return_val_if_fail(IS_BIGINT(dividend), NULL);
 
 	BigInt *rem = NULL; 
 
@@ -1493,13 +1536,13 @@ BigInt* bi_mod_int(const BigInt *dividend, int divisor)
 
 void bi_output(const BigInt *self)
 {
-	return_if_fail(IS_BIGINT(self));
+	arg_return_if_fail(IS_BIGINT(self));
 	stringer_output((const Stringer*) self);
 }
 
 void bi_outputln(const BigInt *self)
 {
-	return_if_fail(IS_BIGINT(self));
+	arg_return_if_fail(IS_BIGINT(self));
 	stringer_outputln((const Stringer*) self);
 }
 
@@ -1514,7 +1557,10 @@ static void stringer_interface_init(StringerInterface *iface)
 
 static void bi_class_init(BigIntClass *klass)
 {
+	object_class_enable_pool((Type) klass);
+
 	OBJECT_CLASS(klass)->ctor = BigInt_ctor;
+	OBJECT_CLASS(klass)->ctor_typed = BigInt_ctor_typed;
 	OBJECT_CLASS(klass)->dtor = BigInt_dtor;
 	OBJECT_CLASS(klass)->cpy = BigInt_cpy;
 	OBJECT_CLASS(klass)->set = BigInt_set;
@@ -18,6 +18,7 @@ struct _DList
 	DListNode *end;
 	FreeFunc ff; // Node free func
 	CpyFunc cpf; // Node cpy func
+	void *share; // Copies share nodes until the first change
 	size_t size;
 	size_t len;
 };
@@ -132,9 +133,9 @@ DListNode* _DList_merge_sort(DListNode *start, DListNode **end, size_t len, CmpF
 
 /* Other {{{ */
 
-static DListNode* _DListNode_new(size_t size)
+static DListNode* _DListNode_new(DList *self)
 {
-	DListNode *res = (DListNode*)calloc(1, size);
+	DListNode *res = (DListNode*)object_mem_alloc((Object*) self, self->size);
 	return_val_if_fail(res != NULL, NULL);
 
 	res->next = NULL;
@@ -143,6 +144,15 @@ static DListNode* _DListNode_new(size_t size)
 	return res;
 }
 
+/* Node memory belongs to the list, unless the user gave his own free func */
+static void _DListNode_free(DList *self, DListNode *node)
+{
+	if (self->ff != NULL)
+		self->ff(node);
+	else
+		object_mem_free((Object*) self, node);
+}
+
 static void _DListNode_swap_case1(DListNode *a, DListNode *b)
 {
 	DListNode *old_a_prev = a->prev;
@@ -200,6 +210,86 @@ static void _DListNode_swap(DListNode *a, DListNode *b)
 
 /* }}} Other */
 
+/* Sharing {{{ */
+
+static void _DList_free_nodes(DList *self, DListNode *current)
+{
+	while (current != NULL) 
+	{
+		DListNode *next = current->next;
+		_DListNode_free(self, current);
+		current = next;
+	}
+}
+
+static DListNode* _DListNode_clone(DList *self, const DListNode *node)
+{
+	DListNode *res = _DListNode_new(self);
+	return_val_if_fail(res != NULL, NULL);
+
+	/* The payload is copied as is only if it owns nothing, otherwise it stays zeroed */
+	if (self->cpf != NULL)
+		self->cpf(res, node);
+	else if (self->ff == NULL)
+		memcpy((char*) res + sizeof(DListNode), (const char*) node + sizeof(DListNode),
+				self->size - sizeof(DListNode));
+
+	res->next = NULL;
+	res->prev = NULL;
+
+	return res;
+}
+
+/*
+ * Gives the list its own nodes if they are still shared with a copy.
+ * The nodes in track are replaced with their clones.
+ */
+static DList* _DList_unshare(DList *self, DListNode **track, size_t track_count)
+{
+	if (object_shared_is_unique(self->share))
+		return self;
+
+	void *share = object_shared_new((Object*) self, 0);
+	return_val_if_fail(share != NULL, NULL);
+
+	DListNode *start = NULL;
+	DListNode *prev = NULL;
+
+	for (DListNode *current = self->start; current != NULL; current = current->next)
+	{
+		DListNode *node = _DListNode_clone(self, current);
+
+		if (node == NULL)
+		{
+			_DList_free_nodes(self, start);
+			object_shared_unref((Object*) self, share);
+			return_val_if_fail(node != NULL, NULL);
+		}
+
+		for (size_t i = 0; i < track_count; ++i)
+			if (track[i] == current)
+				track[i] = node;
+
+		if (prev == NULL)
+			start = node;
+		else
+			prev->next = node;
+
+		node->prev = prev;
+		prev = node;
+	}
+
+	object_shared_unref((Object*) self, self->share);
+
+	self->share = share;
+	self->start = start;
+	self->end = prev;
+
+	return self;
+}
+
+/* }}} */
+
 /* Removing {{{ */
 
 static DList* _DList_rf_val(DList *self, const void *target, CmpFunc cmp_func, bool to_all)
@@ -214,7 +304,7 @@ static DList* _DList_rf_val(DList *self, const void *target, CmpFunc cmp_func, b
 			if (current == self->start)
 			{
 				self->start = current->next;
-				self->ff(current);
+				_DListNode_free(self, current);
 				current = self->start;
 
 				if (current == NULL)
@@ -231,7 +321,7 @@ static DList* _DList_rf_val(DList *self, const void *target, CmpFunc cmp_func, b
 
 				DListNode *tmp = current->prev;
 
-				self->ff(current);
+				_DListNode_free(self, current);
 				current = tmp->next;
 			}
 
@@ -261,7 +351,7 @@ static DList* _DList_rf_sibling(DList *self, DListNode *sibling)
 			if (current == self->start)
 			{
 				self->start = current->next;
-				self->ff(current);
+				_DListNode_free(self, current);
 				current = self->start;
 
 				if (current == NULL)
@@ -278,7 +368,7 @@ static DList* _DList_rf_sibling(DList *self, DListNode *sibling)
 				else
 					self->end = current->prev;
 
-				self->ff(current);
+				_DListNode_free(self, current);
 			}
 
 			self->len--;
@@ -299,49 +389,58 @@ static DList* _DList_rf_sibling(DList *self, DListNode *sibling)
 
 /* Base {{{ */
 
-static Object* DList_ctor(Object *_self, va_list *ap)
+static Object* _DList_init(DList *self, const DListParams *params)
 {
-	DList *self = DLIST(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
-
-	size_t size = va_arg(*ap, size_t);
-	FreeFunc free_func = va_arg(*ap, FreeFunc);
-	CpyFunc cpy_func = va_arg(*ap, CpyFunc);
-
-	if (size < sizeof(DListNode))
+	if (params->size < sizeof(DListNode))
 	{
-		object_delete(_self);
-		return_val_if_fail(size >= sizeof(DListNode), NULL);
+		object_delete((Object*) self);
+		return_val_if_fail(params->size >= sizeof(DListNode), NULL);
 	}
 
-	if (free_func == NULL)
-		self->ff = free;
-	else
-		self->ff = free_func;
+	self->ff = params->free_func;
 
-	self->cpf = cpy_func;
+	self->cpf = params->cpy_func;
+	self->share = object_shared_new((Object*) self, 0);
 	self->start = NULL;
 	self->end = NULL;
 	self->len = 0;
-	self->size = size;
+	self->size = params->size;
+
+	if (self->share == NULL)
+	{
+		object_delete((Object*) self);
+		return_val_if_fail(self->share != NULL, NULL);
+	}
+
+	return (Object*) self;
+}
 
-	return _self;
+static Object* DList_ctor(Object *_self, va_list *ap)
+{
+	DList *self = DLIST(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
+
+	DListParams params;
+
+	params.size = va_arg(*ap, size_t);
+	params.free_func = va_arg(*ap, FreeFunc);
+	params.cpy_func = va_arg(*ap, CpyFunc);
+
+	return _DList_init(self, &params);
+}
+
+static Object* DList_ctor_typed(Object *_self, const void *params)
+{
+	DList *self = DLIST(OBJECT_CLASS(OBJECT_TYPE)->ctor_typed(_self, params));
+	return _DList_init(self, (const DListParams*) params);
 }
 
 static Object* DList_dtor(Object *_self, va_list *ap)
 {
 	DList *self = DLIST(_self);
 
-	if (self->start != NULL)
-	{
-		DListNode *current = self->start;
-
-		while (current != NULL) 
-		{
-			DListNode *next = current->next;
-			self->ff(current);
-			current = next;
-		}
-	}
+	/* The nodes are freed by the last of the copies */
+	if (object_shared_unref((Object*) self, self->share))
+		_DList_free_nodes(self, self->start);
 
 	return (Object*) self;
 }
@@ -353,61 +452,24 @@ static Object* DList_cpy(const Object *_self, Object *_object, va_list *ap)
 
 	object->cpf = self->cpf;
 	object->ff = self->ff;
-	object->start = NULL;
-	object->end = NULL;
+	object->share = object_shared_ref(self->share);
+	object->start = self->start;
+	object->end = self->end;
 	object->len = self->len;
 	object->size = self->size;
 
-	if (self->start == NULL)
-		return (Object*) object;
-
-	DListNode *start = _DListNode_new(self->size);
-
-	if (start == NULL)
-	{
-		object_delete((Object*) object);
-		return_val_if_fail(start != NULL, NULL);
-	}
-
-	if (object->cpf != NULL)
+	/* The nodes own something, which can't be copied, so the copy gets zeroed nodes at once */
+	if (object->cpf == NULL && object->ff != NULL)
 	{
-		va_list ap_copy;
-		va_copy(*ap, ap_copy);
-		object->cpf(start, self->start);
-		va_end(ap_copy);
-	}
+		DList *res = _DList_unshare(object, NULL, 0);
 
-	object->start = start;
-
-	DListNode *s_current = self->start->next;
-	DListNode *o_prev = object->start;
-
-	while (s_current != NULL) 
-	{
-		DListNode *o_prev_next = _DListNode_new(object->size);
-
-		if (o_prev_next == NULL)
+		if (res == NULL)
 		{
 			object_delete((Object*) object);
-			return_val_if_fail(o_prev_next != NULL, NULL);
+			return_val_if_fail(res != NULL, NULL);
 		}
-
-		if (object->cpf != NULL)
-		{
-			va_list ap_copy;
-			va_copy(*ap, ap_copy);
-			object->cpf(o_prev_next, s_current);
-			va_end(ap_copy);
-		}
-
-		o_prev->next = o_prev_next;
-		o_prev_next->prev = o_prev;
-		o_prev = o_prev_next;
-		s_current = s_current->next;
 	}
 
-	object->end = o_prev;
-
 	return (Object*) object;
 }
 
@@ -417,9 +479,11 @@ static Object* DList_cpy(const Object *_self, Object *_object, va_list *ap)
 
 static DListNode* DList_append(DList *self)
 {
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	if (self->start == NULL && self->end == NULL)
 	{
-		self->start = _DListNode_new(self->size);
+		self->start = _DListNode_new(self);
 		return_val_if_fail(self->start != NULL, NULL);
 		self->end = self->start;
 		self->len++;
@@ -427,7 +491,7 @@ static DListNode* DList_append(DList *self)
 		return self->start;
 	}
 
-	DListNode *end = _DListNode_new(self->size);
+	DListNode *end = _DListNode_new(self);
 	return_val_if_fail(end, NULL);
 
 	end->prev = self->end;
@@ -440,9 +504,11 @@ static DListNode* DList_append(DList *self)
 
 static DListNode* DList_prepend(DList *self)
 {
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	if (self->start == NULL && self->end == NULL)
 	{
-		self->start = _DListNode_new(self->size);
+		self->start = _DListNode_new(self);
 		return_val_if_fail(self->start != NULL, NULL);
 		self->end = self->start;
 		self->len++;
@@ -450,7 +516,7 @@ static DListNode* DList_prepend(DList *self)
 		return self->start;
 	}
 
-	DListNode *start = _DListNode_new(self->size);
+	DListNode *start = _DListNode_new(self);
 	return_val_if_fail(start != NULL, NULL);
 
 	start->next = self->start;
@@ -463,7 +529,9 @@ static DListNode* DList_prepend(DList *self)
 
 static DListNode* DList_insert_before(DList *self, DListNode *sibling)
 {
-	DListNode *before = _DListNode_new(self->size);
+	return_val_if_fail(_DList_unshare(self, &sibling, 1) != NULL, NULL);
+
+	DListNode *before = _DListNode_new(self);
 	return_val_if_fail(before != NULL, NULL);
 
 	if (self->start == sibling)
@@ -486,9 +554,11 @@ static DListNode* DList_insert_before(DList *self, DListNode *sibling)
 
 static DListNode* DList_insert(DList *self, size_t index)
 {
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	if (self->start == NULL && self->end == NULL)
 	{
-		self->start = _DListNode_new(self->size);
+		self->start = _DListNode_new(self);
 		return_val_if_fail(self->start != NULL, NULL);
 		self->end = self->start;
 		self->len++;
@@ -500,7 +570,7 @@ static DListNode* DList_insert(DList *self, size_t index)
 	DListNode *current;
 	size_t i;
 
-	node = _DListNode_new(self->size);
+	node = _DListNode_new(self);
 	return_val_if_fail(node != NULL, NULL);
 
 	if (index <= (self->len / 2))
@@ -572,13 +642,15 @@ static DListNode* DList_insert(DList *self, size_t index)
 
 static DListNode* DList_insert_before_val(DList *self, const void *target, CmpFunc cmp_func)
 {
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	DListNode *current = self->start;
 
 	while (current != NULL) 
 	{
 		if (cmp_func(current, target) == 0)
 		{
-			DListNode *before = _DListNode_new(self->size);
+			DListNode *before = _DListNode_new(self);
 			return_val_if_fail(before != NULL, NULL);
 
 			if (self->start == current)
@@ -611,11 +683,15 @@ static DListNode* DList_insert_before_val(DList *self, const void *target, CmpFu
 
 static DList* DList_remove_val(DList *self, const void *target, CmpFunc cmp_func, bool remove_all)
 {
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	return _DList_rf_val(self, target, cmp_func, remove_all);
 }
 
 static DList* DList_remove_sibling(DList *self, DListNode *sibling)
 {
+	return_val_if_fail(_DList_unshare(self, &sibling, 1) != NULL, NULL);
+
 	return _DList_rf_sibling(self, sibling);
 }
 
@@ -624,6 +700,8 @@ static DListNode* DList_pop(DList *self)
 	if (self->len == 0)
 		return NULL;
 
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	DListNode *res;
 
 	if (self->len == 1)
@@ -651,6 +729,8 @@ static DListNode* DList_pop(DList *self)
 
 static DListNode* DList_find(DList *self, const void *target, CmpFunc cmp_func)
 {
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	DListNode *current = self->start;
 
 	while (current != NULL) 
@@ -719,6 +799,8 @@ static void DList_string(const Stringer *_self, va_list *ap)
 
 static void DList_foreach(DList *self, JustFunc func, void *userdata)
 {
+	return_if_fail(_DList_unshare(self, NULL, 0) != NULL);
+
 	DListNode *current = self->start;
 
 	while (current != NULL) 
@@ -730,6 +812,13 @@ static void DList_foreach(DList *self, JustFunc func, void *userdata)
 
 static DList* DListNode_swap(DList *self, DListNode *a, DListNode *b)
 {
+	DListNode *track[] = { a, b };
+
+	return_val_if_fail(_DList_unshare(self, track, 2) != NULL, NULL);
+
+	a = track[0];
+	b = track[1];
+
 	_DListNode_swap(a, b);
 
 	if (a == self->start)
@@ -764,6 +853,8 @@ static size_t DList_count(const DList *self, const void *target, CmpFunc cmp_fun
 
 static DList* DList_reverse(DList *self)
 {
+	return_val_if_fail(_DList_unshare(self, NULL, 0) != NULL, NULL);
+
 	DListNode *current = self->start;
 
 	while (current != NULL) 
@@ -791,108 +882,113 @@ static DList* DList_reverse(DList *self)
 
 DList* dlist_new(size_t size, FreeFunc free_func, CpyFunc cpy_func)
 {
-	return_val_if_fail(size >= sizeof(DListNode), NULL);
-	return (DList*)object_new(DLIST_TYPE, size, free_func, cpy_func);
+	arg_return_val_if_fail(size >= sizeof(DListNode), NULL);
+	return (DList*)object_new_typed(DLIST_TYPE, &(DListParams) {
+			.size = size,
+			.free_func = free_func,
+			.cpy_func = cpy_func
+	});
 }
 
 DListNode* dlist_append(DList *self)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
 	return DList_append(self);
 }
 
 DListNode* dlist_prepend(DList *self)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
 	return DList_prepend(self);
 }
 
 DListNode* dlist_insert(DList *self, size_t index)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
 	return DList_insert(self, index);
 }
 
 DList* dlist_remove_val(DList *self, const void *target, CmpFunc cmp_func, bool remove_all)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return DList_remove_val(self, target, cmp_func, remove_all);
 }
 
 void dlist_foreach(DList *self, JustFunc func, void *userdata)
 {
-	return_if_fail(IS_DLIST(self));
-	return_if_fail(func != NULL);
+	arg_return_if_fail(IS_DLIST(self));
+	arg_return_if_fail(func != NULL);
 	DList_foreach(self, func, userdata);
 }
 
 ssize_t dlist_get_length(const DList *self)
 {
-	return_val_if_fail(IS_DLIST(self), -1);
+	arg_return_val_if_fail(IS_DLIST(self), -1);
 	return self->len;
 }
 
 ssize_t dlist_count(const DList *self, const void *target, CmpFunc cmp_func)
 {
-	return_val_if_fail(IS_DLIST(self), -1);
-	return_val_if_fail(cmp_func != NULL, -1);
+	arg_return_val_if_fail(IS_DLIST(self), -1);
+	arg_return_val_if_fail(cmp_func != NULL, -1);
 	return DList_count(self, target, cmp_func);
 }
 
 DListNode* dlist_insert_before(DList *self, DListNode *sibling)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
-	return_val_if_fail(sibling != NULL, NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(sibling != NULL, NULL);
 	return DList_insert_before(self, sibling);
 }
 
 DListNode* dlist_find(DList *self, const void *target, CmpFunc cmp_func)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return DList_find(self, target, cmp_func);
 }
 
 DList* dlist_remove_sibling(DList *self, DListNode *sibling)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
-	return_val_if_fail(sibling != NULL, NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(sibling != NULL, NULL);
 	return DList_remove_sibling(self, sibling);
 }
 
 void dlist_delete(DList *self)
 {
-	return_if_fail(IS_DLIST(self));
+	arg_return_if_fail(IS_DLIST(self));
 	object_delete((Object*) self);
 }
 
 DList* dlist_copy(const DList *self)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
 	return (DList*)object_copy((const Object*) self);
 }
 
 DList* dlist_swap(DList *self, DListNode *a, DListNode *b)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
-	return_val_if_fail(a != NULL, NULL);
-	return_val_if_fail(b != NULL, NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(a != NULL, NULL);
+	arg_return_val_if_fail(b != NULL, NULL);
 
 	return DListNode_swap(self, a, b);
 }
 
 DListNode* dlist_insert_before_val(DList *self, const void *target, CmpFunc cmp_func)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return DList_insert_before_val(self, target, cmp_func);
 }
 
 void dlist_sort(DList *self, CmpFunc cmp_func)
 {
-	return_if_fail(IS_DLIST(self));
-	return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(IS_DLIST(self));
+	arg_return_if_fail(cmp_func != NULL);
+	return_if_fail(_DList_unshare(self, NULL, 0) != NULL);
 
 	self->start = _DList_merge_sort(self->start, &self->end, self->len, cmp_func);
 
@@ -906,19 +1002,19 @@ void dlist_sort(DList *self, CmpFunc cmp_func)
 
 DList* dlist_reverse(DList *self)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
 	return DList_reverse(self);
 }
 
 DListNode* dlist_pop(DList *self)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
 	return DList_pop(self);
 }
 
 bool dlist_is_empty(const DList *self)
 {
-	return_val_if_fail(IS_DLIST(self), NULL);
+	arg_return_val_if_fail(IS_DLIST(self), NULL);
 	return (self->len == 0) ? true : false;
 }
 
@@ -934,6 +1030,7 @@ static void stringer_interface_init(StringerInterface *iface)
 static void dlist_class_init(DListClass *klass)
 {
 	OBJECT_CLASS(klass)->ctor = DList_ctor;
+	OBJECT_CLASS(klass)->ctor_typed = DList_ctor_typed;
 	OBJECT_CLASS(klass)->dtor = DList_dtor;
 	OBJECT_CLASS(klass)->cpy = DList_cpy;
 }
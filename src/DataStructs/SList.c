@@ -127,9 +127,9 @@ SListNode* _SList_merge_sort(SListNode *start, SListNode **end, size_t len, CmpF
 
 /* Other {{{ */
 
-static SListNode* _SListNode_new(size_t size)
+static SListNode* _SListNode_new(SList *self)
 {
-	SListNode *res = (SListNode*)calloc(1, size);
+	SListNode *res = (SListNode*)object_mem_alloc((Object*) self, self->size);
 	return_val_if_fail(res != NULL, NULL);
 
 	res->next = NULL;
@@ -137,6 +137,15 @@ static SListNode* _SListNode_new(size_t size)
 	return res;
 }
 
+/* Node memory belongs to the list, unless the user gave his own free func */
+static void _SListNode_free(SList *self, SListNode *node)
+{
+	if (self->ff != NULL)
+		self->ff(node);
+	else
+		object_mem_free((Object*) self, node);
+}
+
 static void _SListNode_swap(SListNode *a, SListNode *b)
 {
 	SListNode *tmp = a->next;
@@ -162,7 +171,7 @@ static SList* _SList_rf_val(SList *self, const void *target, CmpFunc cmp_func, b
 			if (prev == NULL)
 			{
 				self->start = current->next;
-				self->ff(current);
+				_SListNode_free(self, current);
 				current = self->start;
 
 				if (current == NULL)
@@ -171,7 +180,7 @@ static SList* _SList_rf_val(SList *self, const void *target, CmpFunc cmp_func, b
 			else 
 			{
 				prev->next = current->next;
-				self->ff(current);
+				_SListNode_free(self, current);
 				current = prev->next;
 
 				if (current == NULL)
@@ -206,7 +215,7 @@ static SList* _SList_rf_sibling(SList *self, SListNode *sibling)
 			if (prev == NULL)
 			{
 				self->start = current->next;
-				self->ff(current);
+				_SListNode_free(self, current);
 				current = self->start;
 
 				if (current == NULL)
@@ -215,7 +224,7 @@ static SList* _SList_rf_sibling(SList *self, SListNode *sibling)
 			else
 			{
 				prev->next = current->next;
-				self->ff(current);
+				_SListNode_free(self, current);
 				current = prev->next;
 
 				if (current == NULL)
@@ -241,32 +250,42 @@ static SList* _SList_rf_sibling(SList *self, SListNode *sibling)
 
 /* Base {{{ */
 
-static Object* SList_ctor(Object *_self, va_list *ap)
+static Object* _SList_init(SList *self, const SListParams *params)
 {
-	SList *self = SLIST(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
-
-	size_t size = va_arg(*ap, size_t);
-	FreeFunc free_func = va_arg(*ap, FreeFunc);
-	CpyFunc cpy_func = va_arg(*ap, CpyFunc);
-
-	if (size < sizeof(SListNode))
+	if (params->size < sizeof(SListNode))
 	{
-		object_delete(_self);
-		return_val_if_fail(size >= sizeof(SListNode), NULL);
+		object_delete((Object*) self);
+		return_val_if_fail(params->size >= sizeof(SListNode), NULL);
 	}
 
-	if (free_func == NULL)
-		self->ff = free;
-	else
-		self->ff = free_func;
+	self->ff = params->free_func;
 
-	self->cpf = cpy_func;
+	self->cpf = params->cpy_func;
 	self->start = NULL;
 	self->end = NULL;
 	self->len = 0;
-	self->size = size;
+	self->size = params->size;
 
-	return _self;
+	return (Object*) self;
+}
+
+static Object* SList_ctor(Object *_self, va_list *ap)
+{
+	SList *self = SLIST(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
+
+	SListParams params;
+
+	params.size = va_arg(*ap, size_t);
+	params.free_func = va_arg(*ap, FreeFunc);
+	params.cpy_func = va_arg(*ap, CpyFunc);
+
+	return _SList_init(self, &params);
+}
+
+static Object* SList_ctor_typed(Object *_self, const void *params)
+{
+	SList *self = SLIST(OBJECT_CLASS(OBJECT_TYPE)->ctor_typed(_self, params));
+	return _SList_init(self, (const SListParams*) params);
 }
 
 static Object* SList_dtor(Object *_self, va_list *ap)
@@ -280,7 +299,7 @@ static Object* SList_dtor(Object *_self, va_list *ap)
 		while (current != NULL) 
 		{
 			SListNode *next = current->next;
-			self->ff(current);
+			_SListNode_free(self, current);
 			current = next;
 		}
 	}
@@ -303,7 +322,7 @@ static Object* SList_cpy(const Object *_self, Object *_object, va_list *ap)
 	if (self->start == NULL)
 		return (Object*) object;
 
-	SListNode *start = _SListNode_new(self->size);
+	SListNode *start = _SListNode_new(object);
 
 	if (start == NULL)
 	{
@@ -326,7 +345,7 @@ static Object* SList_cpy(const Object *_self, Object *_object, va_list *ap)
 
 	while (s_current != NULL) 
 	{
-		SListNode *o_prev_next = _SListNode_new(object->size);
+		SListNode *o_prev_next = _SListNode_new(object);
 
 		if (o_prev_next == NULL)
 		{
@@ -360,7 +379,7 @@ static SListNode* SList_append(SList *self)
 {
 	if (self->start == NULL)
 	{
-		self->start = _SListNode_new(self->size);
+		self->start = _SListNode_new(self);
 		return_val_if_fail(self->start != NULL, NULL);
 		self->end = self->start;
 		self->len++;
@@ -368,7 +387,7 @@ static SListNode* SList_append(SList *self)
 		return self->start;
 	}
 
-	SListNode *end = _SListNode_new(self->size);
+	SListNode *end = _SListNode_new(self);
 	return_val_if_fail(end, NULL);
 
 	self->end->next = end;
@@ -382,7 +401,7 @@ static SListNode* SList_prepend(SList *self)
 {
 	if (self->start == NULL)
 	{
-		self->start = _SListNode_new(self->size);
+		self->start = _SListNode_new(self);
 		return_val_if_fail(self->start != NULL, NULL);
 		self->end = self->start;
 		self->len++;
@@ -390,7 +409,7 @@ static SListNode* SList_prepend(SList *self)
 		return self->start;
 	}
 
-	SListNode *start = _SListNode_new(self->size);
+	SListNode *start = _SListNode_new(self);
 	return_val_if_fail(start != NULL, NULL);
 
 	start->next = self->start;
@@ -409,7 +428,7 @@ static SListNode* SList_insert_before(SList *self, SListNode *sibling)
 	{
 		if (current == sibling)
 		{
-			SListNode *before = _SListNode_new(self->size);
+			SListNode *before = _SListNode_new(self);
 			return_val_if_fail(before != NULL, NULL);
 
 			if (prev == NULL)
@@ -443,7 +462,7 @@ static SListNode* SList_insert_before_val(SList *self, const void *target, CmpFu
 	{
 		if (cmp_func(current, target) == 0)
 		{
-			SListNode *before = _SListNode_new(self->size);
+			SListNode *before = _SListNode_new(self);
 			return_val_if_fail(before != NULL, NULL);
 
 			if (prev == NULL)
@@ -472,7 +491,7 @@ static SListNode* SList_insert(SList *self, size_t index)
 {
 	if (self->start == NULL)
 	{
-		self->start = _SListNode_new(self->size);
+		self->start = _SListNode_new(self);
 		return_val_if_fail(self->start != NULL, NULL);
 		self->end = self->start;
 		self->len++;
@@ -480,7 +499,7 @@ static SListNode* SList_insert(SList *self, size_t index)
 		return self->start;
 	}
 
-	SListNode *node = _SListNode_new(self->size);
+	SListNode *node = _SListNode_new(self);
 	return_val_if_fail(node != NULL, NULL);
 
 	if (index < self->len)
@@ -694,103 +713,107 @@ static SList* SList_swap(SList *self, SListNode *a, SListNode *b)
 
 SList* slist_new(size_t size, FreeFunc free_func, CpyFunc cpy_func)
 {
-	return_val_if_fail(size >= sizeof(SListNode), NULL);
-	return (SList*)object_new(SLIST_TYPE, size, free_func, cpy_func);
+	arg_return_val_if_fail(size >= sizeof(SListNode), NULL);
+	return (SList*)object_new_typed(SLIST_TYPE, &(SListParams) {
+			.size = size,
+			.free_func = free_func,
+			.cpy_func = cpy_func
+	});
 }
 
 void slist_delete(SList *self)
 {
-	return_if_fail(IS_SLIST(self));
+	arg_return_if_fail(IS_SLIST(self));
 	object_delete((Object*) self);
 }
 
 SList* slist_copy(const SList *self)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return (SList*)object_copy((const Object*) self);
 }
 
 SListNode* slist_append(SList *self)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return SList_append(self);
 }
 
 SListNode* slist_insert(SList *self, size_t index)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return SList_insert(self, index);
 }
 
 SListNode* slist_prepend(SList *self)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return SList_prepend(self);
 }
 
 SListNode* slist_insert_before(SList *self, SListNode *sibling)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return SList_insert_before(self, sibling);
 }
 
 SListNode* slist_find(SList* self, const void *target, CmpFunc cmp_func)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return SList_find(self, target, cmp_func);
 }
 
 SList* slist_reverse(SList* self)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return SList_reverse(self);
 }
 
 SList* slist_remove_val(SList *self, const void *target, CmpFunc cmp_func, bool remove_all)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return SList_remove_val(self, target, cmp_func, remove_all);
 }
 
 ssize_t slist_get_length(const SList *self)
 {
-	return_val_if_fail(IS_SLIST(self), -1);
+	arg_return_val_if_fail(IS_SLIST(self), -1);
 	return self->len;
 }
 
 ssize_t slist_count(const SList *self, const void *target, CmpFunc cmp_func)
 {
-	return_val_if_fail(IS_SLIST(self), -1);
-	return_val_if_fail(cmp_func != NULL, -1);
+	arg_return_val_if_fail(IS_SLIST(self), -1);
+	arg_return_val_if_fail(cmp_func != NULL, -1);
 	return SList_count(self, target, cmp_func);
 }
 
 void slist_foreach(SList *self, JustFunc func, void *userdata)
 {
-	return_if_fail(IS_SLIST(self));
-	return_if_fail(func != NULL);
+	arg_return_if_fail(IS_SLIST(self));
+	arg_return_if_fail(func != NULL);
 	return SList_foreach(self, func, userdata);
 }
 
 SList* slist_remove_sibling(SList *self, SListNode *sibling)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return SList_remove_sibling(self, sibling);
 }
 
 SListNode* slist_insert_before_val(SList *self, const void *target, CmpFunc cmp_func)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
-	return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
 	return SList_insert_before_val(self, target, cmp_func);
 }
 
 void slist_sort(SList *self, CmpFunc cmp_func)
 {
-	return_if_fail(IS_SLIST(self));
-	return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(IS_SLIST(self));
+	arg_return_if_fail(cmp_func != NULL);
 
 	self->start = _SList_merge_sort(self->start, &self->end, self->len, cmp_func);
 
@@ -804,22 +827,22 @@ void slist_sort(SList *self, CmpFunc cmp_func)
 
 SList* slist_swap(SList *self, SListNode *a, SListNode *b)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
-	return_val_if_fail(a != NULL, NULL);
-	return_val_if_fail(b != NULL, NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(a != NULL, NULL);
+	arg_return_val_if_fail(b != NULL, NULL);
 
 	return SList_swap(self, a, b);
 }
 
 SListNode* slist_pop(SList *self)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return SList_pop(self);
 }
 
 bool slist_is_empty(const SList *self)
 {
-	return_val_if_fail(IS_SLIST(self), NULL);
+	arg_return_val_if_fail(IS_SLIST(self), NULL);
 	return (self->len == 0) ? true : false;
 
 }
@@ -836,6 +859,7 @@ static void stringer_interface_init(StringerInterface *iface)
 static void slist_class_init(SListClass *klass)
 {
 	OBJECT_CLASS(klass)->ctor = SList_ctor;
+	OBJECT_CLASS(klass)->ctor_typed = SList_ctor_typed;
 	OBJECT_CLASS(klass)->dtor = SList_dtor;
 	OBJECT_CLASS(klass)->cpy = SList_cpy;
 }
@@ -23,6 +23,7 @@ struct _Tree
 	FreeFunc kff;   // Key free func
 	CmpFunc kcf;    // Key cmp func
 	CpyFunc ncpf;   // Node cpy func
+	void *share;    // Copies share nodes until the first change
 	size_t size;
 };
 
@@ -37,15 +38,19 @@ DEFINE_TYPE_WITH_IFACES(Tree, tree, object, 1,
 
 /* Private methods {{{ */
 
-static void _TreeNode_free(TreeNode *node, FreeFunc nff, FreeFunc kff)
+/* Node memory belongs to the tree, unless the user gave his own node free func */
+static void _TreeNode_free(Tree *self, TreeNode *node)
 {
-	if (kff)
-		kff(node->key);
+	if (self->kff)
+		self->kff(node->key);
 
-	nff(node);
+	if (self->nff)
+		self->nff(node);
+	else
+		object_mem_free((Object*) self, node);
 }
 
-static void _TreeNode_free_full(TreeNode *node, FreeFunc nff, FreeFunc kff)
+static void _TreeNode_free_full(Tree *self, TreeNode *node)
 {
 	if (node == NULL)
 		return;
@@ -70,19 +75,16 @@ static void _TreeNode_free_full(TreeNode *node, FreeFunc nff, FreeFunc kff)
 					parent->right = NULL;
 			}
 
-			if (kff)
-				kff(current->key);
-
-			nff(current);
+			_TreeNode_free(self, current);
 
 			current = parent;
 		}
 	}
 }
 
-static TreeNode* _TreeNode_new(size_t size, void *key)
+static TreeNode* _TreeNode_new(Tree *self, void *key)
 {
-	TreeNode *res = (TreeNode*)calloc(1, size);
+	TreeNode *res = (TreeNode*)object_mem_alloc((Object*) self, self->size);
 	return_val_if_fail(res != NULL, NULL);
 
 	res->key = key;
@@ -94,13 +96,17 @@ static TreeNode* _TreeNode_new(size_t size, void *key)
 	return res;
 }
 
-static TreeNode* _TreeNode_clone(const TreeNode *node, size_t size, CpyFunc cpy_func)
+static TreeNode* _TreeNode_clone(Tree *self, const TreeNode *node)
 {
-	TreeNode *res = (TreeNode*)calloc(1, size);
+	TreeNode *res = (TreeNode*)object_mem_alloc((Object*) self, self->size);
 	return_val_if_fail(res != NULL, NULL);
 
-	if (cpy_func)
-		cpy_func(res, node);
+	/* The payload is copied as is only if it owns nothing, otherwise it stays zeroed */
+	if (self->ncpf)
+		self->ncpf(res, node);
+	else if (self->nff == NULL)
+		memcpy((char*) res + sizeof(TreeNode), (const char*) node + sizeof(TreeNode),
+				self->size - sizeof(TreeNode));
 
 	res->key = node->key;
 	res->parent = NULL;
@@ -111,12 +117,12 @@ static TreeNode* _TreeNode_clone(const TreeNode *node, size_t size, CpyFunc cpy_
 	return res;
 }
 
-static TreeNode* _TreeNode_cpy(const TreeNode *node, size_t size, CpyFunc cpy_func)
+static TreeNode* _TreeNode_cpy(Tree *self, const TreeNode *node)
 {
 	if (node == NULL)
 		return NULL;
 
-	TreeNode *root = _TreeNode_clone(node, size, cpy_func);
+	TreeNode *root = _TreeNode_clone(self, node);
 	TreeNode *cpy_node = root;
 	return_val_if_fail(cpy_node != NULL, NULL);
 
@@ -126,7 +132,7 @@ static TreeNode* _TreeNode_cpy(const TreeNode *node, size_t size, CpyFunc cpy_fu
 	{
 		if (orig_node->left != NULL && cpy_node->left == NULL)
 		{
-			cpy_node->left = _TreeNode_clone(orig_node->left, size, cpy_func);
+			cpy_node->left = _TreeNode_clone(self, orig_node->left);
 			cpy_node->left->parent = cpy_node;
 
 			orig_node = orig_node->left;
@@ -134,7 +140,7 @@ static TreeNode* _TreeNode_cpy(const TreeNode *node, size_t size, CpyFunc cpy_fu
 		}
 		else if (orig_node->right != NULL && cpy_node->right == NULL)
 		{
-			cpy_node->right = _TreeNode_clone(orig_node->right, size, cpy_func);
+			cpy_node->right = _TreeNode_clone(self, orig_node->right);
 			cpy_node->right->parent = cpy_node;
 
 			orig_node = orig_node->right;
@@ -150,6 +156,31 @@ static TreeNode* _TreeNode_cpy(const TreeNode *node, size_t size, CpyFunc cpy_fu
 	return root;
 }
 
+/* Gives the tree its own nodes if they are still shared with a copy */
+static Tree* _Tree_unshare(Tree *self)
+{
+	if (object_shared_is_unique(self->share))
+		return self;
+
+	void *share = object_shared_new((Object*) self, 0);
+	return_val_if_fail(share != NULL, NULL);
+
+	TreeNode *root = _TreeNode_cpy(self, self->root);
+
+	if (root == NULL && self->root != NULL)
+	{
+		object_shared_unref((Object*) self, share);
+		return_val_if_fail(root != NULL, NULL);
+	}
+
+	object_shared_unref((Object*) self, self->share);
+
+	self->share = share;
+	self->root = root;
+
+	return self;
+}
+
 static void _Tree_string(const TreeNode *node, StringFunc key_str_func, StringFunc node_str_func, va_list *ap)
 {
 	if (node == NULL)
@@ -448,43 +479,61 @@ static void _Tree_replace_child(Tree *self, TreeNode *n, TreeNode *c)
 
 /* Base {{{ */
 
-static Object* Tree_ctor(Object *_self, va_list *ap)
+static Object* _Tree_init(Tree *self, const TreeParams *params)
 {
-	Tree *self = TREE(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
+	if (params->size < sizeof(TreeNode) || params->key_cmp_func == NULL)
+	{
+		object_delete((Object*) self, false);
+		return_val_if_fail(params->size >= sizeof(TreeNode), NULL);
+		return_val_if_fail(params->key_cmp_func != NULL, NULL);
+	}
 
-	size_t size = va_arg(*ap, size_t);
-	CmpFunc key_cmp_func = va_arg(*ap, CmpFunc);
-	FreeFunc key_free_func = va_arg(*ap, FreeFunc);
-	FreeFunc node_free_func = va_arg(*ap, FreeFunc);
-	CpyFunc node_cpy_func = va_arg(*ap, CpyFunc);
+	self->nff = params->node_free_func;
 
-	if (size < sizeof(TreeNode) || key_cmp_func == NULL)
+	self->kff = params->key_free_func;
+	self->kcf = params->key_cmp_func;
+	self->ncpf = params->node_cpy_func;
+	self->size = params->size;
+	self->root = NULL;
+	self->share = object_shared_new((Object*) self, 0);
+
+	if (self->share == NULL)
 	{
-		object_delete(_self, false);
-		return_val_if_fail(size >= sizeof(TreeNode), NULL);
-		return_val_if_fail(key_cmp_func != NULL, NULL);
+		object_delete((Object*) self, false);
+		return_val_if_fail(self->share != NULL, NULL);
 	}
 
-	if (node_free_func == NULL)
-		self->nff = free;
-	else
-		self->nff = node_free_func;
+	return (Object*) self;
+}
 
-	self->kff = key_free_func;
-	self->kcf = key_cmp_func;
-	self->ncpf = node_cpy_func;
-	self->size = size;
-	self->root = NULL;
+static Object* Tree_ctor(Object *_self, va_list *ap)
+{
+	Tree *self = TREE(OBJECT_CLASS(OBJECT_TYPE)->ctor(_self, ap));
 
-	return _self;
+	TreeParams params;
+
+	params.size = va_arg(*ap, size_t);
+	params.key_cmp_func = va_arg(*ap, CmpFunc);
+	params.key_free_func = va_arg(*ap, FreeFunc);
+	params.node_free_func = va_arg(*ap, FreeFunc);
+	params.node_cpy_func = va_arg(*ap, CpyFunc);
+
+	return _Tree_init(self, &params);
+}
+
+static Object* Tree_ctor_typed(Object *_self, const void *params)
+{
+	Tree *self = TREE(OBJECT_CLASS(OBJECT_TYPE)->ctor_typed(_self, params));
+	return _Tree_init(self, (const TreeParams*) params);
 }
 
 static Object* Tree_dtor(Object *_self, va_list *ap)
 {
 	Tree *self = TREE(_self);
 
-	if (self->root != NULL)
-		_TreeNode_free_full(self->root, self->nff, self->kff);
+	/* The nodes are freed by the last of the copies */
+	if (object_shared_unref((Object*) self, self->share) && self->root != NULL)
+		_TreeNode_free_full(self, self->root);
 
 	return _self;
 }
@@ -499,7 +548,20 @@ static Object* Tree_cpy(const Object *_self, Object *_object, va_list *ap)
 	object->size = self->size;
 	object->kff = self->kff;
 	object->kcf = self->kcf;
-	object->root = _TreeNode_cpy(self->root, self->size, self->ncpf);
+	object->share = object_shared_ref(self->share);
+	object->root = self->root;
+
+	/* The nodes own something, which can't be copied, so the copy gets zeroed nodes at once */
+	if (object->ncpf == NULL && object->nff != NULL)
+	{
+		Tree *res = _Tree_unshare(object);
+
+		if (res == NULL)
+		{
+			object_delete((Object*) object);
+			return_val_if_fail(res != NULL, NULL);
+		}
+	}
 
 	return (Object*) object;
 }
@@ -523,9 +585,11 @@ static void Tree_string(const Stringer *_self, va_list *ap)
 
 static TreeNode* Tree_insert(Tree *self, void *key)
 {
+	return_val_if_fail(_Tree_unshare(self) != NULL, NULL);
+
 	if (self->root == NULL)
 	{
-		self->root = _TreeNode_new(self->size, key);
+		self->root = _TreeNode_new(self, key);
 		return_val_if_fail(self->root != NULL, NULL);
 
 		self->root->color = BLACK;
@@ -566,7 +630,7 @@ static TreeNode* Tree_insert(Tree *self, void *key)
 		}
 	}
 
-	TreeNode *node = _TreeNode_new(self->size, key);
+	TreeNode *node = _TreeNode_new(self, key);
 	return_val_if_fail(node != NULL, NULL);
 
 	if (lr == 0)
@@ -581,7 +645,7 @@ static TreeNode* Tree_insert(Tree *self, void *key)
 	return node;
 }
 
-static TreeNode* Tree_lookup(const Tree *self, const void *key)
+static TreeNode* _Tree_lookup(const Tree *self, const void *key)
 {
 	if (self->root == NULL)
 		return NULL;
@@ -603,13 +667,101 @@ static TreeNode* Tree_lookup(const Tree *self, const void *key)
 	return NULL;
 }
 
-static Tree* Tree_remove(Tree *self, const void *key)
+/* The node can be changed by the caller, so the tree stops sharing it with the copies */
+static TreeNode* Tree_lookup(Tree *self, const void *key)
 {
-	TreeNode *node = Tree_lookup(self, key);
+	return_val_if_fail(_Tree_unshare(self) != NULL, NULL);
+	return _Tree_lookup(self, key);
+}
 
-	if (node == NULL)
+/*
+ * The lookups of a group take turns, each turn is a half step: the first one prefetches
+ * the key of the node, which has arrived, the second compares and prefetches the child.
+ */
+static size_t Tree_lookup_batch(Tree *self, const void * const *keys, size_t nkeys, TreeNode **out)
+{
+	struct
+	{
+		TreeNode *node;
+		size_t index;
+		bool key_loaded;
+	} probes[TREE_LOOKUP_BATCH_GROUP];
+
+	size_t active = 0;
+	size_t next = 0;
+	size_t found = 0;
+
+	return_val_if_fail(_Tree_unshare(self) != NULL, 0);
+
+	if (self->root == NULL)
+	{
+		for (size_t i = 0; i < nkeys; ++i)
+			out[i] = NULL;
+
+		return 0;
+	}
+
+	for (; active < TREE_LOOKUP_BATCH_GROUP && next < nkeys; ++active, ++next)
+	{
+		probes[active].node = self->root;
+		probes[active].index = next;
+		probes[active].key_loaded = false;
+	}
+
+	while (active > 0)
+	{
+		for (size_t j = 0; j < active;)
+		{
+			TreeNode *node = probes[j].node;
+
+			if (!probes[j].key_loaded)
+			{
+				__builtin_prefetch(node->key);
+				probes[j].key_loaded = true;
+				++j;
+				continue;
+			}
+
+			size_t index = probes[j].index;
+			int cmp = self->kcf(node->key, keys[index]);
+			TreeNode *child = (cmp > 0) ? (node->left) : (node->right);
+
+			if (cmp != 0 && child != NULL)
+			{
+				__builtin_prefetch(child);
+				probes[j].node = child;
+				probes[j].key_loaded = false;
+				++j;
+				continue;
+			}
+
+			out[index] = (cmp == 0) ? (node) : (NULL);
+			found += (cmp == 0);
+
+			/* The finished lookup gives its place to the next key or to the last probe */
+			if (next < nkeys)
+			{
+				probes[j].node = self->root;
+				probes[j].index = next++;
+				probes[j].key_loaded = false;
+			}
+			else
+				probes[j] = probes[--active];
+		}
+	}
+
+	return found;
+}
+
+static Tree* Tree_remove(Tree *self, const void *key)
+{
+	if (_Tree_lookup(self, key) == NULL)
 		return NULL;
 
+	return_val_if_fail(_Tree_unshare(self) != NULL, NULL);
+
+	TreeNode *node = _Tree_lookup(self, key);
+
 	TreeNode *n, *c, *p, *s;
 
 	_TreeNode_prepare_remove(self, node, &n, &c);
@@ -700,7 +852,7 @@ static Tree* Tree_remove(Tree *self, const void *key)
 	if (n->parent == NULL && c != NULL)
 		c->color = BLACK;
 
-	_TreeNode_free(n, self->nff, self->kff);
+	_TreeNode_free(self, n);
 
 	return self;
 }
@@ -711,38 +863,52 @@ static Tree* Tree_remove(Tree *self, const void *key)
 
 Tree* tree_new(size_t size, CmpFunc key_cmp_func, FreeFunc key_free_func, FreeFunc node_free_func, CpyFunc node_cpy_func)
 {
-	return_val_if_fail(size >= sizeof(TreeNode), NULL);
-	return_val_if_fail(key_cmp_func != NULL, NULL);
-	return (Tree*)object_new(TREE_TYPE, size, key_cmp_func, key_free_func, node_free_func, node_cpy_func);
+	arg_return_val_if_fail(size >= sizeof(TreeNode), NULL);
+	arg_return_val_if_fail(key_cmp_func != NULL, NULL);
+	return (Tree*)object_new_typed(TREE_TYPE, &(TreeParams) {
+			.size = size,
+			.key_cmp_func = key_cmp_func,
+			.key_free_func = key_free_func,
+			.node_free_func = node_free_func,
+			.node_cpy_func = node_cpy_func
+	});
 }
 
 void tree_delete(Tree *self)
 {
-	return_if_fail(IS_TREE(self));
+	arg_return_if_fail(IS_TREE(self));
 	object_delete((Object*) self);
 }
 
 Tree* tree_copy(const Tree *self)
 {
-	return_val_if_fail(IS_TREE(self), NULL);
+	arg_return_val_if_fail(IS_TREE(self), NULL);
 	return (Tree*)object_copy((Object*) self);
 }
 
 TreeNode* tree_insert(Tree *self, void *key)
 {
-	return_val_if_fail(IS_TREE(self), NULL);
+	arg_return_val_if_fail(IS_TREE(self), NULL);
 	return Tree_insert(self, key);
 }
 
-TreeNode* tree_lookup(const Tree *self, const void *key)
+TreeNode* tree_lookup(Tree *self, const void *key)
 {
-	return_val_if_fail(IS_TREE(self), NULL);
+	arg_return_val_if_fail(IS_TREE(self), NULL);
 	return Tree_lookup(self, key);
 }
 
+size_t tree_lookup_batch(Tree *self, const void * const *keys, size_t nkeys, TreeNode **out)
+{
+	arg_return_val_if_fail(IS_TREE(self), 0);
+	arg_return_val_if_fail(keys != NULL || nkeys == 0, 0);
+	arg_return_val_if_fail(out != NULL || nkeys == 0, 0);
+	return Tree_lookup_batch(self, keys, nkeys, out);
+}
+
 Tree* tree_remove(Tree *self, const void *key)
 {
-	return_val_if_fail(IS_TREE(self), NULL);
+	arg_return_val_if_fail(IS_TREE(self), NULL);
 	return Tree_remove(self, key);
 }
 
@@ -758,6 +924,7 @@ static void stringer_interface_init(StringerInterface *iface)
 static void tree_class_init(TreeClass *klass)
 {
 	OBJECT_CLASS(klass)->ctor = Tree_ctor;
+	OBJECT_CLASS(klass)->ctor_typed = Tree_ctor_typed;
 	OBJECT_CLASS(klass)->dtor = Tree_dtor;
 	OBJECT_CLASS(klass)->cpy = Tree_cpy;
 }
@@ -7,7 +7,7 @@ DEFINE_INTERFACE(Stringer, stringer);
 
 void stringer_output(const Stringer *self, ...)
 {
-	return_if_fail(IS_STRINGER(self));
+	arg_return_if_fail(IS_STRINGER(self));
 
 	StringerInterface *iface = STRINGER_INTERFACE(self);
 
@@ -21,7 +21,7 @@ void stringer_output(const Stringer *self, ...)
 
 void stringer_va_output(const Stringer *self, va_list *ap)
 {
-	return_if_fail(IS_STRINGER(self));
+	arg_return_if_fail(IS_STRINGER(self));
 
 	StringerInterface *iface = STRINGER_INTERFACE(self);
 
@@ -31,7 +31,7 @@ void stringer_va_output(const Stringer *self, va_list *ap)
 
 void stringer_va_outputln(const Stringer *self, va_list *ap)
 {
-	return_if_fail(IS_STRINGER(self));
+	arg_return_if_fail(IS_STRINGER(self));
 
 	StringerInterface *iface = STRINGER_INTERFACE(self);
 
@@ -43,7 +43,7 @@ void stringer_va_outputln(const Stringer *self, va_list *ap)
 
 void stringer_outputln(const Stringer *self, ...)
 {
-	return_if_fail(IS_STRINGER(self));
+	arg_return_if_fail(IS_STRINGER(self));
 
 	StringerInterface *iface = STRINGER_INTERFACE(self);
 
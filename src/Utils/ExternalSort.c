@@ -0,0 +1,670 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Utils/ExternalSort.h"
+#include "Base/Macros.h"
+#include "Base/Messages.h"
+
+#define EXTERNAL_SORT_ALIGN 4096              // Of the buffers, the offsets and the sizes for O_DIRECT
+#define EXTERNAL_SORT_BLOCK_MIN ((size_t)64 << 10) // The smallest buffer of a run while merging
+#define EXTERNAL_SORT_BLOCK_MAX ((size_t)8 << 20)  // The bigger reads are not faster
+
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+typedef struct
+{
+	const ExternalSortParams *params;
+	size_t elemsize;
+	size_t budget;
+	bool direct;
+	int *runs; // Unlinked temporary files
+	size_t n_runs;
+	size_t runs_size;
+} ExternalSort;
+
+typedef struct
+{
+	int fd;
+	ExternalSortOutputFunc func; // Instead of fd
+	void *userdata;
+	char *buf;
+	size_t size; // Multiple of elemsize for func, of EXTERNAL_SORT_ALIGN for the run files
+	size_t used;
+	size_t elemsize;
+	bool direct;
+} ExtWriter;
+
+typedef struct
+{
+	int fd;
+	char *buf;
+	size_t size;
+	size_t pos;
+	size_t avail;
+	char *rec; // The record, which is split between two reads
+	const char *cur; // NULL when the run is over
+	size_t elemsize;
+	bool direct;
+	bool eof;
+} ExtReader;
+
+/* I/O {{{ */
+
+static inline size_t ext_min(size_t a, size_t b)
+{
+	return (a < b) ? (a) : (b);
+}
+
+static inline size_t ext_max(size_t a, size_t b)
+{
+	return (a > b) ? (a) : (b);
+}
+
+static bool ext_read_full(int fd, char *buf, size_t size, bool direct, size_t *got)
+{
+	size_t done = 0;
+
+	while (done < size)
+	{
+		ssize_t res = read(fd, buf + done, size - done);
+
+		if (res < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			msg_error("couldn't read: %s", strerror(errno));
+			return false;
+		}
+
+		if (res == 0)
+			break;
+
+		done += (size_t) res;
+
+		/* Run files are regular, a short read is the end, the next offset isn't aligned */
+		if (direct && done < size)
+			break;
+	}
+
+	*got = done;
+
+	return true;
+}
+
+static bool ext_write_all(int fd, const char *buf, size_t size, bool direct)
+{
+	size_t head = (direct) ? (size / EXTERNAL_SORT_ALIGN * EXTERNAL_SORT_ALIGN) : (size);
+	size_t done = 0;
+
+	while (done < size)
+	{
+		if (done == head)
+		{
+			/* The unaligned tail of a run file */
+			int fl = fcntl(fd, F_GETFL);
+			fcntl(fd, F_SETFL, fl & ~O_DIRECT);
+			head = size;
+		}
+
+		ssize_t res = write(fd, buf + done, head - done);
+
+		if (res < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			msg_error("couldn't write: %s", strerror(errno));
+			return false;
+		}
+
+		done += (size_t) res;
+	}
+
+	return true;
+}
+
+static void* ext_alloc(size_t size)
+{
+	void *ptr = NULL;
+	size = (size + EXTERNAL_SORT_ALIGN - 1) / EXTERNAL_SORT_ALIGN * EXTERNAL_SORT_ALIGN;
+
+	if (posix_memalign(&ptr, EXTERNAL_SORT_ALIGN, size) != 0)
+	{
+		msg_error("couldn't allocate memory for the external sort!");
+		return NULL;
+	}
+
+	return ptr;
+}
+
+/* }}} */
+
+/* Run files {{{ */
+
+static int ext_run_open(ExternalSort *es, const char *dir)
+{
+	static const char name[] = "/oop-sort-XXXXXX";
+	size_t dir_len = strlen(dir);
+	char *path = (char*)malloc(dir_len + sizeof(name));
+
+	if (path == NULL)
+	{
+		msg_error("couldn't allocate memory for a run file name!");
+		return -1;
+	}
+
+	int fd = -1;
+
+	if (es->direct && O_DIRECT != 0)
+	{
+		memcpy(path, dir, dir_len);
+		memcpy(path + dir_len, name, sizeof(name));
+
+		if ((fd = mkostemp(path, O_DIRECT)) < 0 && errno == EINVAL)
+			es->direct = false;
+	}
+	else
+		es->direct = false;
+
+	if (fd < 0 && !es->direct)
+	{
+		memcpy(path, dir, dir_len);
+		memcpy(path + dir_len, name, sizeof(name));
+		fd = mkstemp(path);
+	}
+
+	if (fd < 0)
+	{
+		msg_error("couldn't create a run file in '%s': %s", dir, strerror(errno));
+		free(path);
+		return -1;
+	}
+
+	/* Nobody else needs the name, the file goes away with the descriptor */
+	unlink(path);
+	free(path);
+
+	return fd;
+}
+
+static int ext_run_create(ExternalSort *es)
+{
+	const char *dir = es->params->tmp_dir;
+
+	if (dir == NULL)
+		dir = getenv("TMPDIR");
+	if (dir == NULL || dir[0] == '\0')
+		dir = "/tmp";
+
+	if (es->n_runs == es->runs_size)
+	{
+		size_t new_size = (es->runs_size == 0) ? (16) : (es->runs_size * 2);
+		int *new_runs = (int*)realloc(es->runs, new_size * sizeof(int));
+
+		if (new_runs == NULL)
+		{
+			msg_error("couldn't allocate memory for the run files!");
+			return -1;
+		}
+
+		es->runs = new_runs;
+		es->runs_size = new_size;
+	}
+
+	int fd = ext_run_open(es, dir);
+
+	if (fd >= 0)
+		es->runs[es->n_runs++] = fd;
+
+	return fd;
+}
+
+static bool ext_run_rewind(const ExternalSort *es, int fd)
+{
+	if (lseek(fd, 0, SEEK_SET) != 0)
+	{
+		msg_error("couldn't rewind a run file: %s", strerror(errno));
+		return false;
+	}
+
+	int fl = fcntl(fd, F_GETFL);
+	fcntl(fd, F_SETFL, (es->direct) ? (fl | O_DIRECT) : (fl & ~O_DIRECT));
+
+	return true;
+}
+
+/* }}} */
+
+/* Readers and writers {{{ */
+
+static bool ext_writer_flush(ExtWriter *w)
+{
+	if (w->used == 0)
+		return true;
+
+	bool res;
+
+	if (w->func != NULL)
+		res = w->func(w->buf, w->used / w->elemsize, w->userdata);
+	else
+		res = ext_write_all(w->fd, w->buf, w->used, w->direct);
+
+	w->used = 0;
+
+	return res;
+}
+
+/* For the run files records go through as bytes, so the buffer stays aligned */
+static inline bool ext_writer_put(ExtWriter *w, const char *rec)
+{
+	size_t left = w->elemsize;
+
+	while (left > 0)
+	{
+		size_t n = ext_min(left, w->size - w->used);
+
+		memcpy(w->buf + w->used, rec, n);
+		w->used += n;
+		rec += n;
+		left -= n;
+
+		if (w->used == w->size && !ext_writer_flush(w))
+			return false;
+	}
+
+	return true;
+}
+
+static bool ext_writer_put_many(ExtWriter *w, const char *recs, size_t count)
+{
+	if (!ext_writer_flush(w))
+		return false;
+
+	if (w->func != NULL)
+		return w->func(recs, count, w->userdata);
+
+	return ext_write_all(w->fd, recs, count * w->elemsize, w->direct);
+}
+
+static bool ext_reader_next(ExtReader *r)
+{
+	if (r->avail - r->pos >= r->elemsize)
+	{
+		r->cur = r->buf + r->pos;
+		r->pos += r->elemsize;
+		return true;
+	}
+
+	size_t part = 0;
+
+	while (1)
+	{
+		size_t n = ext_min(r->elemsize - part, r->avail - r->pos);
+
+		memcpy(r->rec + part, r->buf + r->pos, n);
+		part += n;
+		r->pos += n;
+
+		if (part == r->elemsize)
+		{
+			r->cur = r->rec;
+			return true;
+		}
+
+		r->pos = 0;
+		r->avail = 0;
+
+		if (!r->eof)
+		{
+			if (!ext_read_full(r->fd, r->buf, r->size, r->direct, &r->avail))
+				return false;
+
+			r->eof = (r->avail < r->size);
+		}
+
+		if (r->avail == 0)
+		{
+			r->cur = NULL;
+
+			if (part != 0)
+			{
+				msg_error("run file ends in the middle of a record!");
+				return false;
+			}
+
+			return true;
+		}
+	}
+}
+
+/* }}} */
+
+/* Loser tree {{{ */
+
+typedef struct
+{
+	ExtReader *readers;
+	size_t *tree; // tree[0] is the winner, tree[1..k) are the losers, the leaves are k..2k
+	size_t k;
+	CmpFunc cmp_func;
+} LoserTree;
+
+/* An exhausted run loses to everybody, equal records go in the order of the runs */
+static inline bool loser_tree_beats(const LoserTree *lt, size_t a, size_t b)
+{
+	const char *ra = lt->readers[a].cur;
+	const char *rb = lt->readers[b].cur;
+
+	if (ra == NULL || rb == NULL)
+		return (rb == NULL) && (ra != NULL || a < b);
+
+	int res = lt->cmp_func(ra, rb);
+
+	return (res < 0) || (res == 0 && a < b);
+}
+
+static void loser_tree_build(LoserTree *lt, size_t *win)
+{
+	size_t k = lt->k;
+
+	for (size_t n = k; n < 2 * k; ++n)
+		win[n] = n - k;
+
+	for (size_t n = k - 1; n > 0; --n)
+	{
+		size_t a = win[2 * n];
+		size_t b = win[2 * n + 1];
+
+		if (loser_tree_beats(lt, b, a))
+		{
+			size_t t = a;
+			a = b;
+			b = t;
+		}
+
+		win[n] = a;
+		lt->tree[n] = b;
+	}
+
+	lt->tree[0] = (k > 1) ? (win[1]) : (0);
+}
+
+/* The winner has got a new record, it plays its way up again */
+static inline void loser_tree_replay(LoserTree *lt)
+{
+	size_t s = lt->tree[0];
+
+	for (size_t t = (s + lt->k) >> 1; t > 0; t >>= 1)
+	{
+		if (loser_tree_beats(lt, lt->tree[t], s))
+		{
+			size_t tmp = lt->tree[t];
+			lt->tree[t] = s;
+			s = tmp;
+		}
+	}
+
+	lt->tree[0] = s;
+}
+
+/* }}} */
+
+/* External sort {{{ */
+
+static bool ext_sort_run(ExternalSort *es, char *buf, size_t count)
+{
+	const ExternalSortParams *params = es->params;
+
+	if (params->key_width != 0)
+		return radix_sort(buf, count, es->elemsize, params->key_offset, params->key_width, params->radix_flags);
+
+	quicksort(buf, count, es->elemsize, params->cmp_func);
+
+	return true;
+}
+
+/* Sorts the runs of the memory budget, spills them, or sends the only one to out */
+static bool ext_make_runs(ExternalSort *es, int in_fd, ExtWriter *out, bool *done)
+{
+	const ExternalSortParams *params = es->params;
+	bool lsd_radix = (params->key_width != 0 && !(params->radix_flags & RADIX_IN_PLACE));
+
+	/* LSD radix sort needs a buffer of the run's size */
+	size_t cap = es->budget / es->elemsize / ((lsd_radix) ? (2) : (1));
+
+	if (cap == 0)
+	{
+		msg_error("record of %zu bytes doesn't fit in the memory budget!", es->elemsize);
+		return false;
+	}
+
+	char *buf = (char*)ext_alloc(cap * es->elemsize);
+
+	if (buf == NULL)
+		return false;
+
+	bool res = true;
+	*done = false;
+
+	while (res)
+	{
+		size_t got;
+
+		if (!(res = ext_read_full(in_fd, buf, cap * es->elemsize, false, &got)))
+			break;
+
+		if (got % es->elemsize != 0)
+		{
+			msg_error("input ends in the middle of a record!");
+			res = false;
+			break;
+		}
+
+		size_t count = got / es->elemsize;
+		bool last = (count < cap);
+
+		if (count == 0)
+			break;
+
+		if (!(res = ext_sort_run(es, buf, count)))
+			break;
+
+		/* Everything fits in memory, no files at all */
+		if (last && es->n_runs == 0)
+		{
+			res = ext_writer_put_many(out, buf, count);
+			*done = true;
+			break;
+		}
+
+		int fd = ext_run_create(es);
+
+		if (!(res = (fd >= 0) && ext_write_all(fd, buf, got, es->direct)))
+			break;
+
+		if (last)
+			break;
+	}
+
+	free(buf);
+
+	return res;
+}
+
+/* Merges the runs [first, first + k) into out */
+static bool ext_merge(ExternalSort *es, size_t first, size_t k, size_t block, ExtWriter *out)
+{
+	ExtReader *readers = salloc0(ExtReader, k);
+	size_t *tree = salloc(size_t, 2 * k);
+	char *bufs = (char*)ext_alloc(k * block);
+	char *recs = (char*)malloc(k * es->elemsize);
+	bool res = (readers != NULL && tree != NULL && bufs != NULL && recs != NULL);
+
+	if (!res)
+		msg_error("couldn't allocate memory for the merge!");
+
+	for (size_t i = 0; res && i < k; ++i)
+	{
+		ExtReader *r = &readers[i];
+
+		r->fd = es->runs[first + i];
+		r->buf = bufs + i * block;
+		r->size = block;
+		r->rec = recs + i * es->elemsize;
+		r->elemsize = es->elemsize;
+		r->direct = es->direct;
+
+		res = ext_run_rewind(es, r->fd) && ext_reader_next(r);
+	}
+
+	if (res)
+	{
+		LoserTree lt = {
+			.readers = readers,
+			.tree = tree,
+			.k = k,
+			.cmp_func = es->params->cmp_func
+		};
+
+		size_t *win = salloc(size_t, 2 * k);
+		res = (win != NULL);
+
+		if (res)
+		{
+			loser_tree_build(&lt, win);
+			free(win);
+		}
+
+		while (res && readers[tree[0]].cur != NULL)
+		{
+			ExtReader *r = &readers[tree[0]];
+
+			res = ext_writer_put(out, r->cur) && ext_reader_next(r);
+			loser_tree_replay(&lt);
+		}
+	}
+
+	res = res && ext_writer_flush(out);
+
+	free(recs);
+	free(bufs);
+	free(tree);
+	free(readers);
+
+	return res;
+}
+
+static bool ext_sort(int in_fd, const ExternalSortParams *params, ExtWriter *out)
+{
+	ExternalSort es = {
+		.params = params,
+		.elemsize = params->elemsize,
+		.budget = (params->memory_budget != 0) ? (params->memory_budget) : (EXTERNAL_SORT_DEFAULT_BUDGET),
+		.direct = (params->flags & EXTERNAL_SORT_DIRECT_IO) != 0
+	};
+
+	bool done;
+	bool res = ext_make_runs(&es, in_fd, out, &done);
+
+	/* The fan-in is as big as the budget allows with the blocks of at least EXTERNAL_SORT_BLOCK_MIN */
+	size_t fan_in = ext_max(es.budget / EXTERNAL_SORT_BLOCK_MIN, 3) - 1;
+	size_t first = 0;
+	char *out_buf = NULL;
+
+	if (res && !done && es.n_runs > 0)
+	{
+		size_t k = ext_min(es.n_runs, fan_in);
+		size_t block = ext_min(es.budget / (k + 1), EXTERNAL_SORT_BLOCK_MAX);
+		block = ext_max(block / EXTERNAL_SORT_ALIGN, 1) * EXTERNAL_SORT_ALIGN;
+
+		/* Whole records for func, aligned blocks for the run files */
+		size_t out_size = (out->func != NULL) ? (ext_max(block / es.elemsize, 1) * es.elemsize) : (block);
+
+		out_buf = (char*)ext_alloc(ext_max(out_size, block));
+		res = (out_buf != NULL);
+
+		/* Each pass merges the oldest runs into a new one, until the last fits in fan_in */
+		while (res && es.n_runs - first > fan_in)
+		{
+			int fd = ext_run_create(&es);
+
+			ExtWriter run = {
+				.fd = fd,
+				.buf = out_buf,
+				.size = block,
+				.elemsize = es.elemsize,
+				.direct = es.direct
+			};
+
+			res = (fd >= 0) && ext_merge(&es, first, fan_in, block, &run);
+
+			for (size_t i = first; i < first + fan_in; ++i)
+			{
+				close(es.runs[i]);
+				es.runs[i] = -1;
+			}
+
+			first += fan_in;
+		}
+
+		if (res)
+		{
+			out->buf = out_buf;
+			out->size = out_size;
+			res = ext_merge(&es, first, es.n_runs - first, block, out);
+		}
+	}
+
+	for (size_t i = first; i < es.n_runs; ++i)
+		if (es.runs[i] >= 0)
+			close(es.runs[i]);
+
+	free(es.runs);
+	free(out_buf);
+
+	return res;
+}
+
+bool external_sort(int in_fd, int out_fd, const ExternalSortParams *params)
+{
+	arg_return_val_if_fail(in_fd >= 0, false);
+	arg_return_val_if_fail(out_fd >= 0, false);
+	arg_return_val_if_fail(params != NULL, false);
+	arg_return_val_if_fail(params->elemsize != 0, false);
+	arg_return_val_if_fail(params->cmp_func != NULL, false);
+
+	ExtWriter out = {
+		.fd = out_fd,
+		.elemsize = params->elemsize
+	};
+
+	return ext_sort(in_fd, params, &out);
+}
+
+bool external_sort_with_func(int in_fd, const ExternalSortParams *params, ExternalSortOutputFunc func, void *userdata)
+{
+	arg_return_val_if_fail(in_fd >= 0, false);
+	arg_return_val_if_fail(params != NULL, false);
+	arg_return_val_if_fail(params->elemsize != 0, false);
+	arg_return_val_if_fail(params->cmp_func != NULL, false);
+	arg_return_val_if_fail(func != NULL, false);
+
+	ExtWriter out = {
+		.fd = -1,
+		.func = func,
+		.userdata = userdata,
+		.elemsize = params->elemsize
+	};
+
+	return ext_sort(in_fd, params, &out);
+}
+
+/* }}} */
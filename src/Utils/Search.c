@@ -1,14 +1,18 @@
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "Utils/Search.h"
+#include "Utils/Sort.h"
 #include "Base/Definitions.h"
 #include "Base/Macros.h"
 #include "Base/Messages.h"
 
 bool linear_search(void *mass, const void *target, size_t len, size_t elemsize, CmpFunc cmp_func, size_t *index)
 {
-	return_val_if_fail(mass != NULL, false);
-	return_val_if_fail(cmp_func != NULL, false);
-	return_val_if_fail(elemsize != 0, false);
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
 
 	for (size_t i = 0; i < len; ++i) 
 	{
@@ -24,29 +28,301 @@ bool linear_search(void *mass, const void *target, size_t len, size_t elemsize,
 	return false;
 }
 
+/*
+ * Branchless: one comparison per step, the step is a conditional move, not a jump.
+ * Both possible next midpoints are prefetched while the comparison runs.
+ */
+static inline size_t bound_search(const void *mass, const void *target, size_t len, size_t elemsize,
+                                  CmpFunc cmp_func, bool upper)
+{
+	if (len == 0)
+		return 0;
+
+	const char *base = (const char*) mass;
+	size_t n = len;
+
+	while (n > 1)
+	{
+		size_t half = n >> 1;
+		size_t next = (n - half) >> 1;
+
+		__builtin_prefetch(base + next * elemsize);
+		__builtin_prefetch(base + (half + next) * elemsize);
+
+		int res = cmp_func(base + half * elemsize, target);
+		base = ((upper) ? (res <= 0) : (res < 0)) ? (base + half * elemsize) : (base);
+		n -= half;
+	}
+
+	int res = cmp_func(base, target);
+	size_t index = (size_t) (base - (const char*) mass) / elemsize;
+
+	return index + ((upper) ? (res <= 0) : (res < 0));
+}
+
+/* The first element, which isn't less than target, or len */
+size_t lower_bound(const void *mass, const void *target, size_t len, size_t elemsize, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(mass != NULL || len == 0, 0);
+	arg_return_val_if_fail(cmp_func != NULL, 0);
+	arg_return_val_if_fail(elemsize != 0, 0);
+
+	return bound_search(mass, target, len, elemsize, cmp_func, false);
+}
+
+/* The first element, which is greater than target, or len */
+size_t upper_bound(const void *mass, const void *target, size_t len, size_t elemsize, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(mass != NULL || len == 0, 0);
+	arg_return_val_if_fail(cmp_func != NULL, 0);
+	arg_return_val_if_fail(elemsize != 0, 0);
+
+	return bound_search(mass, target, len, elemsize, cmp_func, true);
+}
+
+/* [first, last) are equal to target */
+void equal_range(const void *mass, const void *target, size_t len, size_t elemsize, CmpFunc cmp_func,
+                 size_t *first, size_t *last)
+{
+	arg_return_if_fail(mass != NULL || len == 0);
+	arg_return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(elemsize != 0);
+
+	size_t lo = bound_search(mass, target, len, elemsize, cmp_func, false);
+	size_t hi = lo + bound_search(mass_cell(mass, elemsize, lo), target, len - lo, elemsize, cmp_func, true);
+
+	if (first != NULL)
+		*first = lo;
+	if (last != NULL)
+		*last = hi;
+}
+
 bool binary_search(void *mass, const void *target, size_t left, size_t right, size_t elemsize, CmpFunc cmp_func, size_t *index)
 {
-	return_val_if_fail(mass != NULL, false);
-	return_val_if_fail(cmp_func != NULL, false);
-	return_val_if_fail(elemsize != 0, false);
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
+
+	if (left > right)
+		return false;
+
+	char *base = mass_cell(mass, elemsize, left);
+	size_t len = right - left + 1;
+	size_t i = bound_search(base, target, len, elemsize, cmp_func, false);
+
+	if (i == len || cmp_func(mass_cell(base, elemsize, i), target) != 0)
+		return false;
+
+	if (index != NULL)
+		*index = left + i;
+
+	return true;
+}
+
+/* Batches {{{ */
+
+/*
+ * The group searches in lockstep: every key takes the same steps over the same len,
+ * so each one prefetches its next midpoint while the others are compared.
+ */
+static size_t binary_search_group(const char *mass, const char *keys, size_t len, size_t count,
+                                  size_t elemsize, CmpFunc cmp_func, size_t *indices)
+{
+	const char *base[SEARCH_BATCH_GROUP];
+	size_t found = 0;
+	size_t n = len;
+
+	for (size_t j = 0; j < count; ++j)
+		base[j] = mass;
 
-	while (left <= right) 
+	while (n > 1)
 	{
-		size_t mid = left + ((right - left) >> 1);
+		size_t half = n >> 1;
+		size_t next = (n - half) >> 1;
 
-		if (cmp_func(mass_cell(mass, elemsize, mid), target) == 0)
+		for (size_t j = 0; j < count; ++j)
 		{
-			if (index != NULL)
-				*index = mid;
-
-			return true;
+			int res = cmp_func(base[j] + half * elemsize, keys + j * elemsize);
+			base[j] = (res < 0) ? (base[j] + half * elemsize) : (base[j]);
+			__builtin_prefetch(base[j] + next * elemsize);
 		}
 
-		if (cmp_func(mass_cell(mass, elemsize, mid), target) < 0)
-			left = mid + 1;
+		n -= half;
+	}
+
+	for (size_t j = 0; j < count; ++j)
+	{
+		const char *key = keys + j * elemsize;
+		size_t index = (size_t) (base[j] - mass) / elemsize;
+		int res = cmp_func(base[j], key);
+
+		/* The lower bound is base[j] or the next one */
+		if (res < 0 && ++index < len)
+			res = cmp_func(mass + index * elemsize, key);
+
+		if (res == 0)
+		{
+			indices[j] = index;
+			found++;
+		}
 		else
-			right = mid - 1;
+			indices[j] = SEARCH_NOT_FOUND;
 	}
 
-	return false;
+	return found;
+}
+
+/* mass is sorted, indices[i] is the first position of keys[i] or SEARCH_NOT_FOUND */
+size_t binary_search_batch(const void *mass, const void *keys, size_t len, size_t nkeys, size_t elemsize,
+                           CmpFunc cmp_func, size_t *indices)
+{
+	arg_return_val_if_fail(mass != NULL || len == 0, 0);
+	arg_return_val_if_fail(keys != NULL || nkeys == 0, 0);
+	arg_return_val_if_fail(indices != NULL || nkeys == 0, 0);
+	arg_return_val_if_fail(cmp_func != NULL, 0);
+	arg_return_val_if_fail(elemsize != 0, 0);
+
+	if (len == 0)
+	{
+		for (size_t i = 0; i < nkeys; ++i)
+			indices[i] = SEARCH_NOT_FOUND;
+
+		return 0;
+	}
+
+	size_t found = 0;
+
+	for (size_t start = 0; start < nkeys; start += SEARCH_BATCH_GROUP)
+	{
+		size_t count = (nkeys - start < SEARCH_BATCH_GROUP) ? (nkeys - start) : (SEARCH_BATCH_GROUP);
+
+		found += binary_search_group(mass, mass_cell(keys, elemsize, start), len, count,
+		                             elemsize, cmp_func, indices + start);
+	}
+
+	return found;
+}
+
+/* }}} */
+
+/* Eytzinger index {{{ */
+
+static size_t search_index_fill(SearchIndex *self, const char *mass, const size_t *perm, size_t i, size_t k)
+{
+	if (k > self->len)
+		return i;
+
+	i = search_index_fill(self, mass, perm, i, 2 * k);
+
+	memcpy(mass_cell(self->keys, self->elemsize, k), mass_cell(mass, self->elemsize, perm[i]), self->elemsize);
+	self->index[k] = perm[i];
+
+	return search_index_fill(self, mass, perm, i + 1, 2 * k + 1);
+}
+
+bool search_index_build(SearchIndex *self, const void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(self != NULL, false);
+	arg_return_val_if_fail(mass != NULL || len == 0, false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
+
+	memset(self, 0, sizeof(SearchIndex));
+
+	self->len = len;
+	self->elemsize = elemsize;
+	self->cmp_func = cmp_func;
+
+	/* The 2^shift descendants of a key are contiguous, they are prefetched shift levels ahead */
+	self->prefetch_shift = 1;
+
+	while (((size_t) 2 << self->prefetch_shift) * elemsize <= SEARCH_INDEX_ALIGN)
+		self->prefetch_shift++;
+
+	if (len == 0)
+		return true;
+
+	/* The key 0 isn't used, so that the descendants start at a cache line */
+	size_t size = (len + 1) * elemsize;
+	size = (size + SEARCH_INDEX_ALIGN - 1) / SEARCH_INDEX_ALIGN * SEARCH_INDEX_ALIGN;
+
+	size_t *perm = argsort(mass, len, elemsize, cmp_func);
+	self->keys = (char*)aligned_alloc(SEARCH_INDEX_ALIGN, size);
+	self->index = salloc(size_t, (len + 1));
+
+	if (perm == NULL || self->keys == NULL || self->index == NULL)
+	{
+		free(perm);
+		search_index_clear(self);
+		msg_error("couldn't allocate memory for the search index!");
+		return false;
+	}
+
+	search_index_fill(self, mass, perm, 0, 1);
+	free(perm);
+
+	return true;
 }
+
+/* The Eytzinger position of the first key, which isn't less than target, or 0 */
+static inline size_t search_index_descend(const SearchIndex *self, const void *target)
+{
+	const char *keys = self->keys;
+	size_t elemsize = self->elemsize;
+	unsigned shift = self->prefetch_shift;
+	size_t k = 1;
+
+	while (k <= self->len)
+	{
+		__builtin_prefetch(keys + (k << shift) * elemsize);
+		k = 2 * k + (self->cmp_func(keys + k * elemsize, target) < 0);
+	}
+
+	/* Undo the right turns after the last left one */
+	return k >> __builtin_ffsl(~k);
+}
+
+bool search_index_lookup(const SearchIndex *self, const void *target, size_t *index)
+{
+	arg_return_val_if_fail(self != NULL, false);
+
+	if (self->len == 0)
+		return false;
+
+	size_t k = search_index_descend(self, target);
+
+	if (k == 0 || self->cmp_func(mass_cell(self->keys, self->elemsize, k), target) != 0)
+		return false;
+
+	if (index != NULL)
+		*index = self->index[k];
+
+	return true;
+}
+
+/* The original position of the first key, which isn't less than target, or len */
+size_t search_index_lower_bound(const SearchIndex *self, const void *target)
+{
+	arg_return_val_if_fail(self != NULL, 0);
+
+	if (self->len == 0)
+		return 0;
+
+	size_t k = search_index_descend(self, target);
+
+	return (k == 0) ? (self->len) : (self->index[k]);
+}
+
+void search_index_clear(SearchIndex *self)
+{
+	arg_return_if_fail(self != NULL);
+
+	free(self->keys);
+	free(self->index);
+
+	self->keys = NULL;
+	self->index = NULL;
+	self->len = 0;
+}
+
+/* }}} */
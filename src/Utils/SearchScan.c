@@ -0,0 +1,391 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "Utils/Search.h"
+#include "Base/Macros.h"
+#include "Base/Messages.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_SCAN_X86
+#include <immintrin.h>
+#endif
+
+typedef enum
+{
+	SCAN_FIND,
+	SCAN_FIND_GE,
+	SCAN_COUNT
+} ScanOp;
+
+static atomic_int search_isa = SEARCH_ISA_AUTO;
+
+/* Scalar paths {{{ */
+
+/* base points to the key of the first element, the keys are es bytes apart */
+#define SCAN_SCALAR_DEFINE(suffix, type)                                                     \
+	static size_t scalar_scan_##suffix(const char *base, size_t start, size_t len, size_t es, \
+	                                   type key, ScanOp op, size_t *count)                   \
+	{                                                                                        \
+		for (size_t i = start; i < len; ++i)                                                 \
+		{                                                                                    \
+			type v;                                                                          \
+			memcpy(&v, base + i * es, sizeof(type));                                         \
+                                                                                             \
+			if (op == SCAN_COUNT)                                                            \
+				*count += (v == key);                                                        \
+			else if ((op == SCAN_FIND_GE) ? (v >= key) : (v == key))                         \
+				return i;                                                                    \
+		}                                                                                    \
+                                                                                             \
+		return len;                                                                          \
+	}
+
+SCAN_SCALAR_DEFINE(i8, int8_t)
+SCAN_SCALAR_DEFINE(u8, uint8_t)
+SCAN_SCALAR_DEFINE(i16, int16_t)
+SCAN_SCALAR_DEFINE(u16, uint16_t)
+SCAN_SCALAR_DEFINE(i32, int32_t)
+SCAN_SCALAR_DEFINE(u32, uint32_t)
+SCAN_SCALAR_DEFINE(i64, int64_t)
+SCAN_SCALAR_DEFINE(u64, uint64_t)
+SCAN_SCALAR_DEFINE(f32, float)
+SCAN_SCALAR_DEFINE(f64, double)
+
+/* }}} */
+
+#ifdef SEARCH_SCAN_X86
+
+/*
+ * The vector kernels compare every lane and return the byte mask of the matches,
+ * so the elements of any power of two size up to the vector are scanned the same way:
+ * the mask keeps the first byte of every key.
+ */
+#define SCAN_SIMD_DEFINE(isa, attr, vbytes, suffix, type)                                    \
+	attr static size_t isa##_scan_##suffix(const char *base, size_t bytes, size_t len, size_t es, \
+	                                       uint32_t keep, type key, ScanOp op, size_t *count) \
+	{                                                                                        \
+		size_t vecs = bytes / (vbytes);                                                      \
+                                                                                             \
+		for (size_t v = 0; v < vecs; ++v)                                                    \
+		{                                                                                    \
+			const char *p = base + v * (vbytes);                                             \
+			uint32_t m = (op == SCAN_FIND_GE) ? (isa##_ge_##suffix(p, key)) : (isa##_eq_##suffix(p, key)); \
+			m &= keep;                                                                       \
+                                                                                             \
+			if (op == SCAN_COUNT)                                                            \
+				*count += (size_t) __builtin_popcount(m);                                    \
+			else if (m != 0)                                                                 \
+				return (v * (vbytes) + (size_t) __builtin_ctz(m)) / es;                      \
+		}                                                                                    \
+                                                                                             \
+		return scalar_scan_##suffix(base, vecs * (vbytes) / es, len, es, key, op, count);    \
+	}
+
+/* AVX2 {{{ */
+
+#define AVX2_FUNC __attribute__((target("avx2")))
+
+/* Unsigned keys are compared as signed ones with the flipped sign bit */
+#define AVX2_INT_DEFINE(suffix, type, bits, set1, flip)                                      \
+	AVX2_FUNC static inline uint32_t avx2_eq_##suffix(const char *p, type key)               \
+	{                                                                                        \
+		__m256i x = _mm256_loadu_si256((const __m256i*) p);                                  \
+		return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi##bits(x, set1(key)));        \
+	}                                                                                        \
+	AVX2_FUNC static inline uint32_t avx2_ge_##suffix(const char *p, type key)               \
+	{                                                                                        \
+		__m256i f = set1(flip);                                                              \
+		__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) p), f);             \
+		__m256i k = _mm256_xor_si256(set1(key), f);                                          \
+		return ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi##bits(k, x));               \
+	}                                                                                        \
+	SCAN_SIMD_DEFINE(avx2, AVX2_FUNC, 32, suffix, type)
+
+AVX2_INT_DEFINE(i8, int8_t, 8, _mm256_set1_epi8, 0)
+AVX2_INT_DEFINE(u8, uint8_t, 8, _mm256_set1_epi8, INT8_MIN)
+AVX2_INT_DEFINE(i16, int16_t, 16, _mm256_set1_epi16, 0)
+AVX2_INT_DEFINE(u16, uint16_t, 16, _mm256_set1_epi16, INT16_MIN)
+AVX2_INT_DEFINE(i32, int32_t, 32, _mm256_set1_epi32, 0)
+AVX2_INT_DEFINE(u32, uint32_t, 32, _mm256_set1_epi32, INT32_MIN)
+AVX2_INT_DEFINE(i64, int64_t, 64, _mm256_set1_epi64x, 0)
+AVX2_INT_DEFINE(u64, uint64_t, 64, _mm256_set1_epi64x, INT64_MIN)
+
+AVX2_FUNC static inline uint32_t avx2_eq_f32(const char *p, float key)
+{
+	__m256 x = _mm256_cmp_ps(_mm256_loadu_ps((const float*) p), _mm256_set1_ps(key), _CMP_EQ_OQ);
+	return (uint32_t) _mm256_movemask_epi8(_mm256_castps_si256(x));
+}
+
+AVX2_FUNC static inline uint32_t avx2_ge_f32(const char *p, float key)
+{
+	__m256 x = _mm256_cmp_ps(_mm256_loadu_ps((const float*) p), _mm256_set1_ps(key), _CMP_GE_OQ);
+	return (uint32_t) _mm256_movemask_epi8(_mm256_castps_si256(x));
+}
+
+AVX2_FUNC static inline uint32_t avx2_eq_f64(const char *p, double key)
+{
+	__m256d x = _mm256_cmp_pd(_mm256_loadu_pd((const double*) p), _mm256_set1_pd(key), _CMP_EQ_OQ);
+	return (uint32_t) _mm256_movemask_epi8(_mm256_castpd_si256(x));
+}
+
+AVX2_FUNC static inline uint32_t avx2_ge_f64(const char *p, double key)
+{
+	__m256d x = _mm256_cmp_pd(_mm256_loadu_pd((const double*) p), _mm256_set1_pd(key), _CMP_GE_OQ);
+	return (uint32_t) _mm256_movemask_epi8(_mm256_castpd_si256(x));
+}
+
+SCAN_SIMD_DEFINE(avx2, AVX2_FUNC, 32, f32, float)
+SCAN_SIMD_DEFINE(avx2, AVX2_FUNC, 32, f64, double)
+
+/* }}} */
+
+/* SSE2 {{{ */
+
+#define SSE2_FUNC __attribute__((target("sse2")))
+
+#define SSE2_INT_DEFINE(suffix, type, bits, set1, flip)                                      \
+	SSE2_FUNC static inline uint32_t sse2_eq_##suffix(const char *p, type key)               \
+	{                                                                                        \
+		__m128i x = _mm_loadu_si128((const __m128i*) p);                                     \
+		return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi##bits(x, set1(key)));              \
+	}                                                                                        \
+	SSE2_FUNC static inline uint32_t sse2_ge_##suffix(const char *p, type key)               \
+	{                                                                                        \
+		__m128i f = set1(flip);                                                              \
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*) p), f);                   \
+		__m128i k = _mm_xor_si128(set1(key), f);                                             \
+		return ~(uint32_t) _mm_movemask_epi8(_mm_cmpgt_epi##bits(k, x)) & 0xFFFF;            \
+	}                                                                                        \
+	SCAN_SIMD_DEFINE(sse2, SSE2_FUNC, 16, suffix, type)
+
+SSE2_INT_DEFINE(i8, int8_t, 8, _mm_set1_epi8, 0)
+SSE2_INT_DEFINE(u8, uint8_t, 8, _mm_set1_epi8, INT8_MIN)
+SSE2_INT_DEFINE(i16, int16_t, 16, _mm_set1_epi16, 0)
+SSE2_INT_DEFINE(u16, uint16_t, 16, _mm_set1_epi16, INT16_MIN)
+SSE2_INT_DEFINE(i32, int32_t, 32, _mm_set1_epi32, 0)
+SSE2_INT_DEFINE(u32, uint32_t, 32, _mm_set1_epi32, INT32_MIN)
+
+/* SSE2 has no 64-bit compares: the equality is the both halves, the order is scalar */
+#define SSE2_INT64_DEFINE(suffix, type)                                                      \
+	SSE2_FUNC static inline uint32_t sse2_eq_##suffix(const char *p, type key)               \
+	{                                                                                        \
+		__m128i x = _mm_loadu_si128((const __m128i*) p);                                     \
+		__m128i e = _mm_cmpeq_epi32(x, _mm_set1_epi64x((int64_t) key));                      \
+		e = _mm_and_si128(e, _mm_shuffle_epi32(e, _MM_SHUFFLE(2, 3, 0, 1)));                 \
+		return (uint32_t) _mm_movemask_epi8(e);                                              \
+	}                                                                                        \
+	SSE2_FUNC static inline uint32_t sse2_ge_##suffix(const char *p, type key)               \
+	{                                                                                        \
+		type v[2];                                                                           \
+		memcpy(v, p, sizeof(v));                                                             \
+		return ((v[0] >= key) ? (0x00FFu) : (0)) | ((v[1] >= key) ? (0xFF00u) : (0));        \
+	}                                                                                        \
+	SCAN_SIMD_DEFINE(sse2, SSE2_FUNC, 16, suffix, type)
+
+SSE2_INT64_DEFINE(i64, int64_t)
+SSE2_INT64_DEFINE(u64, uint64_t)
+
+SSE2_FUNC static inline uint32_t sse2_eq_f32(const char *p, float key)
+{
+	__m128 x = _mm_cmpeq_ps(_mm_loadu_ps((const float*) p), _mm_set1_ps(key));
+	return (uint32_t) _mm_movemask_epi8(_mm_castps_si128(x));
+}
+
+SSE2_FUNC static inline uint32_t sse2_ge_f32(const char *p, float key)
+{
+	__m128 x = _mm_cmpge_ps(_mm_loadu_ps((const float*) p), _mm_set1_ps(key));
+	return (uint32_t) _mm_movemask_epi8(_mm_castps_si128(x));
+}
+
+SSE2_FUNC static inline uint32_t sse2_eq_f64(const char *p, double key)
+{
+	__m128d x = _mm_cmpeq_pd(_mm_loadu_pd((const double*) p), _mm_set1_pd(key));
+	return (uint32_t) _mm_movemask_epi8(_mm_castpd_si128(x));
+}
+
+SSE2_FUNC static inline uint32_t sse2_ge_f64(const char *p, double key)
+{
+	__m128d x = _mm_cmpge_pd(_mm_loadu_pd((const double*) p), _mm_set1_pd(key));
+	return (uint32_t) _mm_movemask_epi8(_mm_castpd_si128(x));
+}
+
+SCAN_SIMD_DEFINE(sse2, SSE2_FUNC, 16, f32, float)
+SCAN_SIMD_DEFINE(sse2, SSE2_FUNC, 16, f64, double)
+
+/* }}} */
+
+#endif /* SEARCH_SCAN_X86 */
+
+/* Dispatch {{{ */
+
+static SearchIsa search_scan_best_isa(void)
+{
+#ifdef SEARCH_SCAN_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return SEARCH_ISA_AVX2;
+	else if (__builtin_cpu_supports("sse2"))
+		return SEARCH_ISA_SSE2;
+#endif
+
+	return SEARCH_ISA_SCALAR;
+}
+
+static SearchIsa search_scan_isa(void)
+{
+	int isa = atomic_load_explicit(&search_isa, memory_order_relaxed);
+
+	if (isa != SEARCH_ISA_AUTO)
+		return isa;
+
+	isa = search_scan_best_isa();
+	atomic_store_explicit(&search_isa, isa, memory_order_relaxed);
+
+	return isa;
+}
+
+bool search_scan_set_isa(SearchIsa isa)
+{
+	arg_return_val_if_fail(isa >= SEARCH_ISA_AUTO && isa <= SEARCH_ISA_AVX2, false);
+
+	if (isa > search_scan_best_isa())
+		return false;
+
+	atomic_store_explicit(&search_isa, isa, memory_order_relaxed);
+
+	return true;
+}
+
+size_t search_key_size(SearchKeyType key_type)
+{
+	switch (key_type) {
+		case SEARCH_KEY_INT8:
+		case SEARCH_KEY_UINT8:
+			return 1;
+		case SEARCH_KEY_INT16:
+		case SEARCH_KEY_UINT16:
+			return 2;
+		case SEARCH_KEY_INT32:
+		case SEARCH_KEY_UINT32:
+		case SEARCH_KEY_FLOAT:
+			return 4;
+		case SEARCH_KEY_INT64:
+		case SEARCH_KEY_UINT64:
+		case SEARCH_KEY_DOUBLE:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+#ifdef SEARCH_SCAN_X86
+#define SCAN_CASE(key_enum, suffix, type)                                                    \
+	case key_enum:                                                                           \
+	{                                                                                        \
+		type k;                                                                              \
+		memcpy(&k, key, sizeof(type));                                                       \
+                                                                                             \
+		if (vbytes == 32)                                                                    \
+			return avx2_scan_##suffix(base, bytes, len, elemsize, keep, k, op, count);       \
+		if (vbytes == 16)                                                                    \
+			return sse2_scan_##suffix(base, bytes, len, elemsize, keep, k, op, count);       \
+                                                                                             \
+		return scalar_scan_##suffix(base, 0, len, elemsize, k, op, count);                   \
+	}
+#else
+#define SCAN_CASE(key_enum, suffix, type)                                                    \
+	case key_enum:                                                                           \
+	{                                                                                        \
+		type k;                                                                              \
+		memcpy(&k, key, sizeof(type));                                                       \
+		return scalar_scan_##suffix(base, 0, len, elemsize, k, op, count);                   \
+	}
+#endif
+
+static size_t linear_scan(const void *mass, size_t len, size_t elemsize, size_t key_offset,
+                          SearchKeyType key_type, const void *key, ScanOp op, size_t *count)
+{
+	size_t width = search_key_size(key_type);
+
+	return_val_if_fail(width != 0, len);
+	return_val_if_fail(key_offset + width <= elemsize, len);
+	return_val_if_fail(mass != NULL || len == 0, len);
+	return_val_if_fail(key != NULL, len);
+
+	if (len == 0)
+		return 0;
+
+	const char *base = (const char*) mass + key_offset;
+	size_t bytes = len * elemsize - key_offset;
+	size_t vbytes = 0;
+	uint32_t keep = 0;
+
+	switch (search_scan_isa()) {
+		case SEARCH_ISA_AVX2:
+			vbytes = 32;
+			break;
+		case SEARCH_ISA_SSE2:
+			vbytes = 16;
+			break;
+		default:
+			break;
+	}
+
+	/* Then the elements are a power of two not less than the key, the keys fall on the lanes */
+	if (vbytes % elemsize != 0)
+		vbytes = 0;
+
+	for (size_t b = 0; b < vbytes; b += elemsize)
+		keep |= 1u << b;
+
+#ifndef SEARCH_SCAN_X86
+	(void) keep;
+	(void) bytes;
+#endif
+
+	switch (key_type) {
+		SCAN_CASE(SEARCH_KEY_INT8, i8, int8_t)
+		SCAN_CASE(SEARCH_KEY_UINT8, u8, uint8_t)
+		SCAN_CASE(SEARCH_KEY_INT16, i16, int16_t)
+		SCAN_CASE(SEARCH_KEY_UINT16, u16, uint16_t)
+		SCAN_CASE(SEARCH_KEY_INT32, i32, int32_t)
+		SCAN_CASE(SEARCH_KEY_UINT32, u32, uint32_t)
+		SCAN_CASE(SEARCH_KEY_INT64, i64, int64_t)
+		SCAN_CASE(SEARCH_KEY_UINT64, u64, uint64_t)
+		SCAN_CASE(SEARCH_KEY_FLOAT, f32, float)
+		SCAN_CASE(SEARCH_KEY_DOUBLE, f64, double)
+		default:
+			return len;
+	}
+}
+
+/* }}} */
+
+/* The first element, whose key is equal to *key, or len */
+size_t linear_find_typed(const void *mass, size_t len, size_t elemsize, size_t key_offset,
+                         SearchKeyType key_type, const void *key)
+{
+	return linear_scan(mass, len, elemsize, key_offset, key_type, key, SCAN_FIND, NULL);
+}
+
+/* The first element, whose key isn't less than *key, or len (mass needn't be sorted) */
+size_t linear_find_ge_typed(const void *mass, size_t len, size_t elemsize, size_t key_offset,
+                            SearchKeyType key_type, const void *key)
+{
+	return linear_scan(mass, len, elemsize, key_offset, key_type, key, SCAN_FIND_GE, NULL);
+}
+
+size_t linear_count_typed(const void *mass, size_t len, size_t elemsize, size_t key_offset,
+                          SearchKeyType key_type, const void *key)
+{
+	size_t count = 0;
+
+	if (len == 0)
+		return 0;
+
+	linear_scan(mass, len, elemsize, key_offset, key_type, key, SCAN_COUNT, &count);
+
+	return count;
+}
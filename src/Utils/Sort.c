@@ -1,47 +1,161 @@
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "Utils/Sort.h"
+#include "Utils/SortTemplate.h"
+#include "Utils/Search.h"
 #include "Base/Macros.h"
 #include "Base/Messages.h"
 
-#define SORT_LEN_THRESHOLD 16
 
-#define SWAP(a, b, elemsize)          \
-{                                     \
-	size_t __size = (elemsize);       \
-	char *__a = (a); char *__b = (b); \
-	do                                \
-	{                                 \
-		char __tmp = *__a;            \
-		*__a++ = *__b;                \
-		*__b++ = __tmp;               \
-	} while (--__size > 0);           \
+#define SWAP_WORDS_MAX 64
+#define SWAP_BLOCK 64
+#define INSSORT_STACK_ELEM 256
+#define SORT_NETWORK_THRESHOLD SORT_SMALL_MAX
+
+/* Swaps {{{ */
+
+static inline void swap_words(char *a, char *b, size_t elemsize)
+{
+	for (size_t i = 0; i < elemsize; i += sizeof(uint64_t))
+	{
+		uint64_t ta, tb;
+		memcpy(&ta, a + i, sizeof(uint64_t));
+		memcpy(&tb, b + i, sizeof(uint64_t));
+		memcpy(a + i, &tb, sizeof(uint64_t));
+		memcpy(b + i, &ta, sizeof(uint64_t));
+	}
+}
+
+static inline void swap_words32(char *a, char *b, size_t elemsize)
+{
+	for (size_t i = 0; i < elemsize; i += sizeof(uint32_t))
+	{
+		uint32_t ta, tb;
+		memcpy(&ta, a + i, sizeof(uint32_t));
+		memcpy(&tb, b + i, sizeof(uint32_t));
+		memcpy(a + i, &tb, sizeof(uint32_t));
+		memcpy(b + i, &ta, sizeof(uint32_t));
+	}
+}
+
+/* Large records are moved through the stack buffer by the blocks */
+static inline void swap_block(char *a, char *b, size_t elemsize)
+{
+	char tmp[SWAP_BLOCK];
+
+	while (elemsize > 0)
+	{
+		size_t n = (elemsize < SWAP_BLOCK) ? elemsize : SWAP_BLOCK;
+
+		memcpy(tmp, a, n);
+		memcpy(a, b, n);
+		memcpy(b, tmp, n);
+
+		a += n;
+		b += n;
+		elemsize -= n;
+	}
+}
+
+/*
+ * The element size doesn't change during the sort,
+ * so the dispatch is always predicted.
+ */
+static inline void copy_elem(char *dst, const char *src, size_t elemsize)
+{
+	switch (elemsize) {
+		case 4:
+			memcpy(dst, src, 4);
+			return;
+		case 8:
+			memcpy(dst, src, 8);
+			return;
+		case 16:
+			memcpy(dst, src, 16);
+			return;
+	}
+
+	memcpy(dst, src, elemsize);
+}
+
+static inline void swap_elems(void *_a, void *_b, size_t elemsize)
+{
+	char *a = _a;
+	char *b = _b;
+
+	switch (elemsize) {
+		case 4:
+		{
+			uint32_t ta, tb;
+			memcpy(&ta, a, 4);
+			memcpy(&tb, b, 4);
+			memcpy(a, &tb, 4);
+			memcpy(b, &ta, 4);
+			return;
+		}
+		case 8:
+		{
+			uint64_t ta, tb;
+			memcpy(&ta, a, 8);
+			memcpy(&tb, b, 8);
+			memcpy(a, &tb, 8);
+			memcpy(b, &ta, 8);
+			return;
+		}
+		case 16:
+			swap_words(a, b, 16);
+			return;
+	}
+
+	if ((elemsize % sizeof(uint64_t)) == 0 && elemsize <= SWAP_WORDS_MAX)
+		swap_words(a, b, elemsize);
+	else if ((elemsize % sizeof(uint32_t)) == 0 && elemsize <= SWAP_WORDS_MAX)
+		swap_words32(a, b, elemsize);
+	else
+		swap_block(a, b, elemsize);
 }
 
+/* }}} */
+
 /* Insertion sort */
 void inssort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
 {
-	return_if_fail(mass != NULL);
-	return_if_fail(cmp_func != NULL);
-	return_if_fail(elemsize != 0);
+	arg_return_if_fail(mass != NULL);
+	arg_return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(elemsize != 0);
+
+	char stack_tmp[INSSORT_STACK_ELEM];
+	char *tmp = stack_tmp;
 
-	for (int i = 1; i < len; ++i) 
+	if (elemsize > INSSORT_STACK_ELEM)
 	{
-		size_t cur = i;
+		tmp = (char*)malloc(elemsize);
+		return_if_fail(tmp != NULL);
+	}
 
-		for (size_t j = i - 1; j >= 0; --j) 
-		{
-			if (cmp_func(mass_cell(mass, elemsize, j), mass_cell(mass, elemsize, cur)) <= 0)
-				break;
+	for (size_t i = 1; i < len; ++i) 
+	{
+		if (cmp_func(mass_cell(mass, elemsize, i - 1), mass_cell(mass, elemsize, i)) <= 0)
+			continue;
 
-			SWAP(mass_cell(mass, elemsize, j), mass_cell(mass, elemsize, cur), elemsize);
+		/* Shift the run of the greater elements once and insert the element after it */
+		memcpy(tmp, mass_cell(mass, elemsize, i), elemsize);
 
-			cur = j;
+		size_t j = i - 1;
 
-			if (j == 0)
-				break;
-		}
+		while (j > 0 && cmp_func(mass_cell(mass, elemsize, j - 1), tmp) > 0)
+			j--;
+
+		memmove(mass_cell(mass, elemsize, j + 1), mass_cell(mass, elemsize, j), (i - j) * elemsize);
+		memcpy(mass_cell(mass, elemsize, j), tmp, elemsize);
 	}
+
+	if (tmp != stack_tmp)
+		free(tmp);
 }
 
 /* Heapsort */
@@ -58,7 +172,7 @@ static inline void heap(void *mass, size_t start, size_t end, size_t elemsize, C
 
 		if (cmp_func(mass_cell(mass, elemsize, root), mass_cell(mass, elemsize, child)) < 0)
 		{
-			SWAP(mass_cell(mass, elemsize, root), mass_cell(mass, elemsize, child), elemsize);
+			swap_elems(mass_cell(mass, elemsize, root), mass_cell(mass, elemsize, child), elemsize);
 			root = child;
 		}
 		else
@@ -83,9 +197,9 @@ static inline void heapify(void *mass, size_t len, size_t elemsize, CmpFunc cmp_
 
 void heapsort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
 {
-	return_if_fail(mass != NULL);
-	return_if_fail(cmp_func != NULL);
-	return_if_fail(elemsize != 0);
+	arg_return_if_fail(mass != NULL);
+	arg_return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(elemsize != 0);
 
 	size_t end = len - 1;
 
@@ -96,117 +210,2127 @@ void heapsort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
 
 	while (end > 0)
 	{
-		SWAP(mass_cell(mass, elemsize, 0), mass_cell(mass, elemsize, end), elemsize);
+		swap_elems(mass_cell(mass, elemsize, 0), mass_cell(mass, elemsize, end), elemsize);
 		end--;
 		heap(mass, 0, end, elemsize, cmp_func);
 	}
 }
 
-/* Based on Knuth vol. 3 */
-static inline size_t quicksort_partition(void *mass, size_t left, size_t right, size_t pivot, size_t elemsize, CmpFunc cmp_func)
+/* Pattern-defeating quicksort {{{ */
+
+#define PDQ_INSSORT_THRESHOLD 24
+#define PDQ_NINTHER_THRESHOLD 128
+#define PDQ_PARTIAL_INSSORT_LIMIT 8
+#define PDQ_BLOCK 64
+
+typedef struct
+{
+	size_t elemsize;
+	CmpFunc cmp_func;
+	char *pivot; // The pivot is moved out of the range while partitioning
+	char *tmp;
+	bool indirect; // The elements are the pointers to the records, which are compared
+	SearchKeyType key_type; // If it's set, the keys at key_offset are compared instead of cmp_func
+	size_t key_offset;
+} PdqSort;
+
+#define PDQ_KEY_CASE(key_enum, type)   \
+	case key_enum:                      \
+	{                                   \
+		type ka, kb;                    \
+		memcpy(&ka, a, sizeof(type));   \
+		memcpy(&kb, b, sizeof(type));   \
+		return ka < kb;                 \
+	}
+
+/* The key type doesn't change during the sort, so the dispatch is always predicted */
+static inline bool pdq_key_less(SearchKeyType key_type, const char *a, const char *b)
+{
+	switch (key_type) {
+		PDQ_KEY_CASE(SEARCH_KEY_INT8, int8_t)
+		PDQ_KEY_CASE(SEARCH_KEY_UINT8, uint8_t)
+		PDQ_KEY_CASE(SEARCH_KEY_INT16, int16_t)
+		PDQ_KEY_CASE(SEARCH_KEY_UINT16, uint16_t)
+		PDQ_KEY_CASE(SEARCH_KEY_INT32, int32_t)
+		PDQ_KEY_CASE(SEARCH_KEY_UINT32, uint32_t)
+		PDQ_KEY_CASE(SEARCH_KEY_INT64, int64_t)
+		PDQ_KEY_CASE(SEARCH_KEY_UINT64, uint64_t)
+		PDQ_KEY_CASE(SEARCH_KEY_FLOAT, float)
+		PDQ_KEY_CASE(SEARCH_KEY_DOUBLE, double)
+		default:
+			return false;
+	}
+}
+
+#undef PDQ_KEY_CASE
+
+static inline bool pdq_less(const PdqSort *pdq, const char *a, const char *b)
+{
+	if (pdq->key_type != SEARCH_KEY_NONE)
+		return pdq_key_less(pdq->key_type, a + pdq->key_offset, b + pdq->key_offset);
+
+	if (!pdq->indirect)
+		return pdq->cmp_func(a, b) < 0;
+
+	const char *ra = *(char* const*) a;
+	const char *rb = *(char* const*) b;
+	int res = pdq->cmp_func(ra, rb);
+
+	/* The records are in one mass, so the equal ones keep their order */
+	return (res < 0) || (res == 0 && ra < rb);
+}
+
+/*
+ * Insertion sort of [begin, end). If it isn't guarded, the element before begin
+ * must not be greater than any of the range. Gives up when more than limit
+ * elements have been moved.
+ */
+static bool pdq_inssort(const PdqSort *pdq, char *begin, char *end, bool guarded, size_t limit)
 {
-	size_t i = left + 1;
-	size_t j = right;
+	size_t es = pdq->elemsize;
+	size_t moved = 0;
 
-	if (pivot != left)
-		SWAP(mass_cell(mass, elemsize, left), mass_cell(mass, elemsize, pivot), elemsize);
+	if (begin == end)
+		return true;
 
-	while (1) 
+	for (char *cur = begin + es; cur != end; cur += es)
 	{
-		while (cmp_func(mass_cell(mass, elemsize, i), mass_cell(mass, elemsize, left)) < 0)
-			i++;
+		char *sift = cur;
+		char *sift_1 = cur - es;
 
-		while (cmp_func(mass_cell(mass, elemsize, left), mass_cell(mass, elemsize, j)) < 0)
-			j--;
+		if (!pdq_less(pdq, sift, sift_1))
+			continue;
+
+		copy_elem(pdq->tmp, sift, es);
 
-		if (j <= i)
+		do
 		{
-			SWAP(mass_cell(mass, elemsize, j), mass_cell(mass, elemsize, left), elemsize);
-			return j;
-		}
+			copy_elem(sift, sift_1, es);
+			sift = sift_1;
+			sift_1 -= es;
+		} while ((!guarded || sift != begin) && pdq_less(pdq, pdq->tmp, sift_1));
+
+		copy_elem(sift, pdq->tmp, es);
 
-		SWAP(mass_cell(mass, elemsize, i), mass_cell(mass, elemsize, j), elemsize);
+		moved += (cur - sift) / es;
 
-		i++;
-		j--;
+		if (moved > limit)
+			return false;
 	}
 
-	return 0;
+	return true;
+}
+
+static inline void pdq_sort2(const PdqSort *pdq, char *a, char *b)
+{
+	if (pdq_less(pdq, b, a))
+		swap_elems(a, b, pdq->elemsize);
+}
+
+static inline void pdq_sort3(const PdqSort *pdq, char *a, char *b, char *c)
+{
+	pdq_sort2(pdq, a, b);
+	pdq_sort2(pdq, b, c);
+	pdq_sort2(pdq, a, b);
+}
+
+/* Exchanges the misplaced elements found by the blocks, by a single cycle if the counts differ */
+static inline void pdq_swap_offsets(const PdqSort *pdq, char *first, char *last, const unsigned char *offsets_l,
+                                    const unsigned char *offsets_r, size_t num, bool use_swaps)
+{
+	size_t es = pdq->elemsize;
+
+	if (use_swaps)
+	{
+		for (size_t i = 0; i < num; ++i)
+			swap_elems(first + offsets_l[i] * es, last - offsets_r[i] * es, es);
+	}
+	else if (num > 0)
+	{
+		char *l = first + offsets_l[0] * es;
+		char *r = last - offsets_r[0] * es;
+
+		copy_elem(pdq->tmp, l, es);
+		copy_elem(l, r, es);
+
+		for (size_t i = 1; i < num; ++i)
+		{
+			l = first + offsets_l[i] * es;
+			copy_elem(r, l, es);
+			r = last - offsets_r[i] * es;
+			copy_elem(l, r, es);
+		}
+
+		copy_elem(r, pdq->tmp, es);
+	}
 }
 
-static inline size_t find_median(void *mass, size_t a, size_t b, size_t c, size_t elemsize, CmpFunc cmp_func)
+/*
+ * Partitions [begin, end) around *begin into [less than the pivot] pivot [not less],
+ * the comparisons only fill the offsets of the blocks, so there are no branches on them.
+ * already_partitioned is true if no element had to be moved.
+ */
+static char* pdq_partition_right(const PdqSort *pdq, char *begin, char *end, bool *already_partitioned)
 {
-	if (cmp_func(mass_cell(mass, elemsize, a), mass_cell(mass, elemsize, b)) > 0)
+	size_t es = pdq->elemsize;
+	char *pivot = pdq->pivot;
+	char *first = begin;
+	char *last = end;
+
+	copy_elem(pivot, begin, es);
+
+	/* The median selection guarantees that these loops stop */
+	do
+		first += es;
+	while (pdq_less(pdq, first, pivot));
+
+	if (first - es == begin)
+		while (first < last && !pdq_less(pdq, last -= es, pivot));
+	else
+		while (!pdq_less(pdq, last -= es, pivot));
+
+	*already_partitioned = (first >= last);
+
+	if (!*already_partitioned)
 	{
-		if (cmp_func(mass_cell(mass, elemsize, b), mass_cell(mass, elemsize, c)) > 0)
-			return b;
-		else if (cmp_func(mass_cell(mass, elemsize, a), mass_cell(mass, elemsize, c)) > 0)
-			return c;
-		else 
-			return a;
+		swap_elems(first, last, es);
+		first += es;
+
+		unsigned char offsets_l[PDQ_BLOCK];
+		unsigned char offsets_r[PDQ_BLOCK];
+		char *offsets_l_base = first;
+		char *offsets_r_base = last;
+		size_t num_l = 0;
+		size_t num_r = 0;
+		size_t start_l = 0;
+		size_t start_r = 0;
+
+		while (first < last)
+		{
+			size_t num_unknown = (last - first) / es;
+			size_t left_split = (num_l == 0) ? ((num_r == 0) ? (num_unknown / 2) : num_unknown) : 0;
+			size_t right_split = (num_r == 0) ? (num_unknown - left_split) : 0;
+			size_t n;
+
+			n = (left_split < PDQ_BLOCK) ? left_split : PDQ_BLOCK;
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				offsets_l[num_l] = i;
+				num_l += !pdq_less(pdq, first, pivot);
+				first += es;
+			}
+
+			n = (right_split < PDQ_BLOCK) ? right_split : PDQ_BLOCK;
+
+			for (size_t i = 0; i < n;)
+			{
+				offsets_r[num_r] = ++i;
+				last -= es;
+				num_r += pdq_less(pdq, last, pivot);
+			}
+
+			size_t num = (num_l < num_r) ? num_l : num_r;
+
+			pdq_swap_offsets(pdq, offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r,
+			                 num, num_l == num_r);
+
+			num_l -= num;
+			num_r -= num;
+			start_l += num;
+			start_r += num;
+
+			if (num_l == 0)
+			{
+				start_l = 0;
+				offsets_l_base = first;
+			}
+
+			if (num_r == 0)
+			{
+				start_r = 0;
+				offsets_r_base = last;
+			}
+		}
+
+		/* Only one side has misplaced elements left, they go to the boundary */
+		if (num_l != 0)
+		{
+			const unsigned char *offsets = offsets_l + start_l;
+
+			while (num_l-- > 0)
+			{
+				last -= es;
+				swap_elems(offsets_l_base + offsets[num_l] * es, last, es);
+			}
+
+			first = last;
+		}
+
+		if (num_r != 0)
+		{
+			const unsigned char *offsets = offsets_r + start_r;
+
+			while (num_r-- > 0)
+			{
+				swap_elems(offsets_r_base - offsets[num_r] * es, first, es);
+				first += es;
+			}
+		}
 	}
+
+	char *pivot_pos = first - es;
+
+	copy_elem(begin, pivot_pos, es);
+	copy_elem(pivot_pos, pivot, es);
+
+	return pivot_pos;
+}
+
+/* Partitions [begin, end) around *begin into [not greater than the pivot] pivot [greater] */
+static char* pdq_partition_left(const PdqSort *pdq, char *begin, char *end)
+{
+	size_t es = pdq->elemsize;
+	char *pivot = pdq->pivot;
+	char *first = begin;
+	char *last = end;
+
+	copy_elem(pivot, begin, es);
+
+	do
+		last -= es;
+	while (pdq_less(pdq, pivot, last));
+
+	if (last + es == end)
+		while (first < last && !pdq_less(pdq, pivot, first += es));
 	else
+		while (!pdq_less(pdq, pivot, first += es));
+
+	while (first < last)
 	{
-		if (cmp_func(mass_cell(mass, elemsize, a), mass_cell(mass, elemsize, c)) > 0)
-			return a;
-		else if (cmp_func(mass_cell(mass, elemsize, b), mass_cell(mass, elemsize, c)) > 0)
-			return c;
-		else 
-			return b;
+		swap_elems(first, last, es);
+
+		do
+			last -= es;
+		while (pdq_less(pdq, pivot, last));
+
+		do
+			first += es;
+		while (!pdq_less(pdq, pivot, first));
 	}
+
+	copy_elem(begin, last, es);
+	copy_elem(last, pivot, es);
+
+	return last;
 }
 
-static inline void quicksort_recursive(void *mass, size_t left, size_t right, size_t elemsize, CmpFunc cmp_func)
+/* Swaps a few elements at the quarters, so the next pivots don't repeat the bad one */
+static void pdq_shuffle(const PdqSort *pdq, char *begin, char *pivot_pos, char *end, size_t l_size, size_t r_size)
 {
-	size_t mid;
-	size_t pivot;
-	size_t new_pivot;
+	size_t es = pdq->elemsize;
+
+	if (l_size >= PDQ_INSSORT_THRESHOLD)
+	{
+		size_t q = l_size / 4;
+
+		swap_elems(begin, begin + q * es, es);
+		swap_elems(pivot_pos - es, pivot_pos - q * es, es);
+
+		if (l_size > PDQ_NINTHER_THRESHOLD)
+		{
+			swap_elems(begin + es, begin + (q + 1) * es, es);
+			swap_elems(begin + 2 * es, begin + (q + 2) * es, es);
+			swap_elems(pivot_pos - 2 * es, pivot_pos - (q + 1) * es, es);
+			swap_elems(pivot_pos - 3 * es, pivot_pos - (q + 2) * es, es);
+		}
+	}
+
+	if (r_size >= PDQ_INSSORT_THRESHOLD)
+	{
+		size_t q = r_size / 4;
+
+		swap_elems(pivot_pos + es, pivot_pos + (q + 1) * es, es);
+		swap_elems(end - es, end - q * es, es);
+
+		if (r_size > PDQ_NINTHER_THRESHOLD)
+		{
+			swap_elems(pivot_pos + 2 * es, pivot_pos + (q + 2) * es, es);
+			swap_elems(pivot_pos + 3 * es, pivot_pos + (q + 3) * es, es);
+			swap_elems(end - 2 * es, end - (q + 1) * es, es);
+			swap_elems(end - 3 * es, end - (q + 2) * es, es);
+		}
+	}
+}
 
-	int loop_count = 0;
-	int max_loops = ULONG_BIT - __builtin_clzl(right - left);
+/* The fallback of pdq_loop(), it compares through pdq_less() like the rest, so it's right for the indirect sort */
+static void pdq_sift_down(const PdqSort *pdq, char *begin, size_t root, size_t size)
+{
+	size_t es = pdq->elemsize;
 
-	while (1) 
+	while (1)
 	{
-		if (right <= left)
+		size_t child = (root << 1) + 1;
+
+		if (child >= size)
+			return;
+
+		if (child + 1 < size && pdq_less(pdq, begin + child * es, begin + (child + 1) * es))
+			child++;
+
+		if (!pdq_less(pdq, begin + root * es, begin + child * es))
 			return;
 
-		if ((right - left + 1) <= SORT_LEN_THRESHOLD)
+		swap_elems(begin + root * es, begin + child * es, es);
+		root = child;
+	}
+}
+
+static void pdq_heapsort(const PdqSort *pdq, char *begin, size_t size)
+{
+	size_t es = pdq->elemsize;
+
+	for (size_t i = size >> 1; i > 0; --i)
+		pdq_sift_down(pdq, begin, i - 1, size);
+
+	for (size_t end = size - 1; end > 0; --end)
+	{
+		swap_elems(begin, begin + end * es, es);
+		pdq_sift_down(pdq, begin, 0, end);
+	}
+}
+
+/* Ninther for the large ranges, median of three otherwise; the pivot goes to begin */
+static inline void pdq_choose_pivot(const PdqSort *pdq, char *begin, char *end, size_t size)
+{
+	size_t es = pdq->elemsize;
+	size_t s2 = size / 2;
+
+	if (size > PDQ_NINTHER_THRESHOLD)
+	{
+		pdq_sort3(pdq, begin, begin + s2 * es, end - es);
+		pdq_sort3(pdq, begin + es, begin + (s2 - 1) * es, end - 2 * es);
+		pdq_sort3(pdq, begin + 2 * es, begin + (s2 + 1) * es, end - 3 * es);
+		pdq_sort3(pdq, begin + (s2 - 1) * es, begin + s2 * es, begin + (s2 + 1) * es);
+		swap_elems(begin, begin + s2 * es, es);
+	}
+	else
+		pdq_sort3(pdq, begin + s2 * es, begin, end - es);
+}
+
+static void pdq_loop(const PdqSort *pdq, char *begin, char *end, int bad_allowed, bool leftmost)
+{
+	size_t es = pdq->elemsize;
+
+	while (1)
+	{
+		size_t size = (end - begin) / es;
+
+		if (size < PDQ_INSSORT_THRESHOLD)
 		{
-			inssort(mass_cell(mass, elemsize, left), right - left + 1, elemsize, cmp_func);
+			pdq_inssort(pdq, begin, end, leftmost, SIZE_MAX);
 			return;
 		}
 
-		if (++loop_count >= max_loops)
+		pdq_choose_pivot(pdq, begin, end, size);
+
+		/*
+		 * The element before the range is not greater than any of it, if it equals
+		 * the pivot, there are many equal elements, they are put aside at once.
+		 */
+		if (!leftmost && !pdq_less(pdq, begin - es, begin))
 		{
-			heapsort(mass_cell(mass, elemsize, left), right - left + 1, elemsize, cmp_func);
-			return;
+			begin = pdq_partition_left(pdq, begin, end) + es;
+			continue;
 		}
 
-		mid = left + ((right - left) >> 1);
-		pivot = find_median(mass, left, mid, right, elemsize, cmp_func);
-		new_pivot = quicksort_partition(mass, left, right, pivot, elemsize, cmp_func);
+		bool already_partitioned;
+		char *pivot_pos = pdq_partition_right(pdq, begin, end, &already_partitioned);
+		size_t l_size = (pivot_pos - begin) / es;
+		size_t r_size = (end - pivot_pos) / es - 1;
+
+		if (l_size < size / 8 || r_size < size / 8)
+		{
+			if (--bad_allowed == 0)
+			{
+				pdq_heapsort(pdq, begin, size);
+				return;
+			}
 
-		if (new_pivot == 0)
+			pdq_shuffle(pdq, begin, pivot_pos, end, l_size, r_size);
+		}
+		else if (already_partitioned &&
+		         pdq_inssort(pdq, begin, pivot_pos, true, PDQ_PARTIAL_INSSORT_LIMIT) &&
+		         pdq_inssort(pdq, pivot_pos + es, end, true, PDQ_PARTIAL_INSSORT_LIMIT))
 			return;
 
-		if ((new_pivot - left - 1) > (right - new_pivot - 1))
+		pdq_loop(pdq, begin, pivot_pos, bad_allowed, leftmost);
+		begin = pivot_pos + es;
+		leftmost = false;
+	}
+}
+
+/* pdq holds the way of the comparison, the buffers are set here */
+static void pdq_sort(PdqSort *pdq, void *mass, size_t len)
+{
+	size_t elemsize = pdq->elemsize;
+	max_align_t stack_tmp[(2 * INSSORT_STACK_ELEM) / sizeof(max_align_t)];
+	char *tmp = (char*)stack_tmp;
+
+	if (elemsize > INSSORT_STACK_ELEM)
+	{
+		tmp = (char*)malloc(2 * elemsize);
+		return_if_fail(tmp != NULL);
+	}
+
+	pdq->pivot = tmp;
+	pdq->tmp = tmp + elemsize;
+
+	pdq_loop(pdq, mass, mass_cell(mass, elemsize, len), ULONG_BIT - __builtin_clzl(len), true);
+
+	if (tmp != (char*)stack_tmp)
+		free(tmp);
+}
+
+void quicksort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
+{
+	arg_return_if_fail(mass != NULL);
+	arg_return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(elemsize != 0);
+
+	if (len <= 1)
+		return;
+
+	pdq_sort(&(PdqSort) {
+		.elemsize = elemsize,
+		.cmp_func = cmp_func
+	}, mass, len);
+}
+
+/* }}} */
+
+/* Indirect sort {{{ */
+
+/*
+ * perm[i] is the index of the element, which goes to the position i in the sorted order.
+ * The sort is stable. The permutation belongs to the caller.
+ */
+size_t* argsort(const void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(mass != NULL, NULL);
+	arg_return_val_if_fail(cmp_func != NULL, NULL);
+	arg_return_val_if_fail(elemsize != 0, NULL);
+
+	size_t *perm = salloc(size_t, len);
+	const char **ptrs = salloc(const char*, len);
+
+	if (len > 0 && (perm == NULL || ptrs == NULL))
+	{
+		free(perm);
+		free(ptrs);
+		msg_error("couldn't allocate memory for the permutation!");
+		return NULL;
+	}
+
+	for (size_t i = 0; i < len; ++i)
+		ptrs[i] = mass_cell(mass, elemsize, i);
+
+	if (len > 1)
+		pdq_sort(&(PdqSort) {
+			.elemsize = sizeof(char*),
+			.cmp_func = cmp_func,
+			.indirect = true
+		}, ptrs, len);
+
+	for (size_t i = 0; i < len; ++i)
+		perm[i] = (size_t) (ptrs[i] - (const char*) mass) / elemsize;
+
+	free(ptrs);
+
+	return perm;
+}
+
+/*
+ * Moves the element perm[i] to the position i, every element is moved once along the cycles.
+ * perm has to be a permutation of [0, len), else nothing is moved and false is returned.
+ */
+bool permute_apply(void *mass, size_t len, size_t elemsize, const size_t *perm)
+{
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(perm != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
+
+	if (len <= 1)
+		return true;
+
+	size_t words = (len + ULONG_BIT - 1) / ULONG_BIT;
+	unsigned long *done = salloc0(unsigned long, words);
+	char *tmp = (char*)malloc(elemsize);
+
+	if (done == NULL || tmp == NULL)
+	{
+		free(done);
+		free(tmp);
+		msg_error("couldn't allocate memory for the permutation!");
+		return false;
+	}
+
+	/* Every index has to be in range and taken once, else the cycles never close */
+	for (size_t i = 0; i < len; ++i)
+	{
+		size_t from = perm[i];
+
+		if (from >= len || ((done[from / ULONG_BIT] >> (from % ULONG_BIT)) & 1UL))
 		{
-			quicksort_recursive(mass, new_pivot + 1, right, elemsize, cmp_func);
-			right = new_pivot - 1;
+			free(tmp);
+			free(done);
+			msg_warn("perm isn't a permutation of [0, %lu)!", len);
+			return false;
 		}
-		else 
+
+		done[from / ULONG_BIT] |= 1UL << (from % ULONG_BIT);
+	}
+
+	memset(done, 0, words * sizeof(unsigned long));
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		if ((done[i / ULONG_BIT] >> (i % ULONG_BIT)) & 1UL)
+			continue;
+
+		done[i / ULONG_BIT] |= 1UL << (i % ULONG_BIT);
+
+		if (perm[i] == i)
+			continue;
+
+		copy_elem(tmp, mass_cell(mass, elemsize, i), elemsize);
+
+		size_t j = i;
+
+		while (perm[j] != i)
 		{
-			quicksort_recursive(mass, left, new_pivot - 1, elemsize, cmp_func);
-			left = new_pivot + 1;
+			size_t from = perm[j];
+
+			copy_elem(mass_cell(mass, elemsize, j), mass_cell(mass, elemsize, from), elemsize);
+			done[from / ULONG_BIT] |= 1UL << (from % ULONG_BIT);
+			j = from;
 		}
+
+		copy_elem(mass_cell(mass, elemsize, j), tmp, elemsize);
 	}
+
+	free(tmp);
+	free(done);
+
+	return true;
 }
 
-void quicksort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
+/* Stable, the records are compared through the pointers and moved once */
+bool sort_indirect(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
+
+	if (len <= 1)
+		return true;
+
+	size_t *perm = argsort(mass, len, elemsize, cmp_func);
+	return_val_if_fail(perm != NULL, false);
+
+	bool res = permute_apply(mass, len, elemsize, perm);
+	free(perm);
+
+	return res;
+}
+
+/* }}} */
+
+/* Selection {{{ */
+
+#define SELECT_GROUP 5
+
+static void pdq_select(const PdqSort *pdq, char *begin, char *end, char *nth, int bad_allowed, bool leftmost);
+
+/* Median of the medians of the groups of five goes to begin, size > SELECT_GROUP */
+static void pdq_median_of_medians(const PdqSort *pdq, char *begin, size_t size)
 {
-	return_if_fail(mass != NULL);
-	return_if_fail(cmp_func != NULL);
-	return_if_fail(elemsize != 0);
+	size_t es = pdq->elemsize;
+	size_t ngroups = 0;
+
+	for (size_t i = 0; i < size; i += SELECT_GROUP)
+	{
+		size_t n = (size - i < SELECT_GROUP) ? (size - i) : SELECT_GROUP;
+		char *group = begin + i * es;
+
+		pdq_inssort(pdq, group, group + n * es, true, SIZE_MAX);
+		swap_elems(begin + ngroups * es, group + (n / 2) * es, es);
+		ngroups++;
+	}
+
+	char *median = begin + (ngroups / 2) * es;
 
-	quicksort_recursive(mass, 0, len - 1, elemsize, cmp_func);
+	pdq_select(pdq, begin, begin + ngroups * es, median, ULONG_BIT - __builtin_clzl(ngroups), true);
+	swap_elems(begin, median, es);
 }
+
+/*
+ * Introselect: quickselect with the pivots of pdqsort, which falls back to
+ * the median of medians, when the partitions have been bad for too long.
+ */
+static void pdq_select(const PdqSort *pdq, char *begin, char *end, char *nth, int bad_allowed, bool leftmost)
+{
+	size_t es = pdq->elemsize;
+
+	while (1)
+	{
+		size_t size = (end - begin) / es;
+
+		if (size < PDQ_INSSORT_THRESHOLD)
+		{
+			pdq_inssort(pdq, begin, end, true, SIZE_MAX);
+			return;
+		}
+
+		if (bad_allowed > 0)
+		{
+			bad_allowed--;
+			pdq_choose_pivot(pdq, begin, end, size);
+		}
+		else
+			pdq_median_of_medians(pdq, begin, size);
+
+		/* See pdq_loop(), all of [begin, pivot_pos] equal the pivot */
+		if (!leftmost && !pdq_less(pdq, begin - es, begin))
+		{
+			char *pivot_pos = pdq_partition_left(pdq, begin, end);
+
+			if (nth <= pivot_pos)
+				return;
+
+			begin = pivot_pos + es;
+			continue;
+		}
+
+		bool already_partitioned;
+		char *pivot_pos = pdq_partition_right(pdq, begin, end, &already_partitioned);
+
+		if (nth == pivot_pos)
+			return;
+
+		if (nth < pivot_pos)
+			end = pivot_pos;
+		else
+		{
+			begin = pivot_pos + es;
+			leftmost = false;
+		}
+	}
+}
+
+/*
+ * Puts the element, which would be at the index k in the sorted mass, there.
+ * None of the elements before it are greater, none of the elements after it are less.
+ */
+void select_nth(void *mass, size_t len, size_t elemsize, size_t k, CmpFunc cmp_func)
+{
+	arg_return_if_fail(mass != NULL);
+	arg_return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(elemsize != 0);
+	arg_return_if_fail(k < len);
+
+	if (len <= 1)
+		return;
+
+	max_align_t stack_tmp[(2 * INSSORT_STACK_ELEM) / sizeof(max_align_t)];
+	char *tmp = (char*)stack_tmp;
+
+	if (elemsize > INSSORT_STACK_ELEM)
+	{
+		tmp = (char*)malloc(2 * elemsize);
+		return_if_fail(tmp != NULL);
+	}
+
+	PdqSort pdq = {
+		.elemsize = elemsize,
+		.cmp_func = cmp_func,
+		.pivot = tmp,
+		.tmp = tmp + elemsize,
+		.indirect = false
+	};
+
+	pdq_select(&pdq, mass, mass_cell(mass, elemsize, len), mass_cell(mass, elemsize, k),
+	           2 * (ULONG_BIT - __builtin_clzl(len)), true);
+
+	if (tmp != (char*)stack_tmp)
+		free(tmp);
+}
+
+/* Sorts the first k elements of the sorted mass into [0, k), the rest are in no particular order */
+void partial_sort(void *mass, size_t len, size_t elemsize, size_t k, CmpFunc cmp_func)
+{
+	arg_return_if_fail(mass != NULL);
+	arg_return_if_fail(cmp_func != NULL);
+	arg_return_if_fail(elemsize != 0);
+	arg_return_if_fail(k <= len);
+
+	if (k == 0)
+		return;
+
+	if (k == len)
+	{
+		quicksort(mass, len, elemsize, cmp_func);
+		return;
+	}
+
+	/* The element k - 1 is in its place already */
+	select_nth(mass, len, elemsize, k - 1, cmp_func);
+	quicksort(mass, k - 1, elemsize, cmp_func);
+}
+
+bool topk_init(TopK *self, size_t k, size_t elemsize, CmpFunc cmp_func)
+{
+	arg_return_val_if_fail(self != NULL, false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
+
+	self->mass = NULL;
+	self->len = 0;
+	self->k = k;
+	self->elemsize = elemsize;
+	self->cmp_func = cmp_func;
+
+	if (k == 0)
+		return true;
+
+	self->mass = (char*)malloc(k * elemsize);
+
+	if (self->mass == NULL)
+	{
+		msg_error("couldn't allocate memory for top-k!");
+		return false;
+	}
+
+	return true;
+}
+
+/* Until there are k elements they are just collected, then the greatest of them is at the root of the heap */
+void topk_push(TopK *self, const void *elem)
+{
+	arg_return_if_fail(self != NULL);
+	arg_return_if_fail(elem != NULL);
+
+	size_t es = self->elemsize;
+
+	if (self->len < self->k)
+	{
+		copy_elem(mass_cell(self->mass, es, self->len++), elem, es);
+
+		if (self->len == self->k)
+			heapify(self->mass, self->len, es, self->cmp_func);
+
+		return;
+	}
+
+	if (self->k == 0 || self->cmp_func(elem, self->mass) >= 0)
+		return;
+
+	copy_elem(self->mass, elem, es);
+	heap(self->mass, 0, self->k - 1, es, self->cmp_func);
+}
+
+/* The first (up to) k of the pushed elements in the sorted order, the mass belongs to the caller */
+void* topk_finish(TopK *self, size_t *len)
+{
+	arg_return_val_if_fail(self != NULL, NULL);
+
+	void *mass = self->mass;
+
+	if (mass != NULL)
+		quicksort(mass, self->len, self->elemsize, self->cmp_func);
+
+	if (len != NULL)
+		*len = self->len;
+
+	self->mass = NULL;
+	self->len = 0;
+
+	return mass;
+}
+
+void topk_clear(TopK *self)
+{
+	arg_return_if_fail(self != NULL);
+
+	free(self->mass);
+	self->mass = NULL;
+	self->len = 0;
+}
+
+/* }}} */
+
+/* Typed sorts {{{ */
+
+/* The small partitions of int32 and int64 go to the sorting networks */
+SORT_DEFINE_WITH_BASE(int32_kernel, int32_t, a < b, SORT_NETWORK_THRESHOLD, sort_small_i32)
+SORT_DEFINE_WITH_BASE(int64_kernel, int64_t, a < b, SORT_NETWORK_THRESHOLD, sort_small_i64)
+SORT_DEFINE(uint64_kernel, uint64_t, a < b)
+SORT_DEFINE(double_kernel, double, a < b)
+SORT_DEFINE(ptr_kernel, void*, (uintptr_t) a < (uintptr_t) b)
+
+void sort_int32(int32_t *mass, size_t len)
+{
+	arg_return_if_fail(mass != NULL);
+	int32_kernel_introsort(mass, len);
+}
+
+void sort_int64(int64_t *mass, size_t len)
+{
+	arg_return_if_fail(mass != NULL);
+	int64_kernel_introsort(mass, len);
+}
+
+void sort_uint64(uint64_t *mass, size_t len)
+{
+	arg_return_if_fail(mass != NULL);
+	uint64_kernel_introsort(mass, len);
+}
+
+/* The order of NaNs is unspecified */
+void sort_double(double *mass, size_t len)
+{
+	arg_return_if_fail(mass != NULL);
+	double_kernel_introsort(mass, len);
+}
+
+void sort_ptr(void **mass, size_t len)
+{
+	arg_return_if_fail(mass != NULL);
+	ptr_kernel_introsort(mass, len);
+}
+
+size_t sort_key_size(SortKeyType key_type)
+{
+	switch (key_type) {
+		case SORT_KEY_INT32:
+			return sizeof(int32_t);
+		case SORT_KEY_INT64:
+			return sizeof(int64_t);
+		case SORT_KEY_UINT64:
+			return sizeof(uint64_t);
+		case SORT_KEY_DOUBLE:
+			return sizeof(double);
+		case SORT_KEY_PTR:
+			return sizeof(void*);
+	}
+
+	return 0;
+}
+
+bool sort_typed(void *mass, size_t len, SortKeyType key_type)
+{
+	arg_return_val_if_fail(mass != NULL, false);
+
+	switch (key_type) {
+		case SORT_KEY_INT32:
+			int32_kernel_introsort((int32_t*) mass, len);
+			return true;
+		case SORT_KEY_INT64:
+			int64_kernel_introsort((int64_t*) mass, len);
+			return true;
+		case SORT_KEY_UINT64:
+			uint64_kernel_introsort((uint64_t*) mass, len);
+			return true;
+		case SORT_KEY_DOUBLE:
+			double_kernel_introsort((double*) mass, len);
+			return true;
+		case SORT_KEY_PTR:
+			ptr_kernel_introsort((void**) mass, len);
+			return true;
+	}
+
+	msg_warn("unknown key type!");
+	return false;
+}
+
+/* The typed key is compared inside pdqsort, which keeps its pattern detection */
+bool sort_by_typed_key(void *mass, size_t len, size_t elemsize, size_t key_offset, SearchKeyType key_type)
+{
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(search_key_size(key_type) != 0, false);
+	arg_return_val_if_fail(key_offset + search_key_size(key_type) <= elemsize, false);
+
+	if (len <= 1)
+		return true;
+
+	pdq_sort(&(PdqSort) {
+		.elemsize = elemsize,
+		.key_type = key_type,
+		.key_offset = key_offset
+	}, mass, len);
+
+	return true;
+}
+
+/* }}} */
+
+/* Radix sort {{{ */
+
+#define RADIX_INSSORT_THRESHOLD 32
+#define RADIX_SMALL_LEN (1 << 16)
+#define RADIX_LARGE_LEN (1 << 22)
+
+typedef struct
+{
+	size_t offset;
+	size_t width;
+	size_t elemsize;
+	RadixFlags flags;
+} RadixKey;
+
+/* The key as the unsigned number, which has the same order as the original key */
+static inline uint64_t radix_key(const char *elem, const RadixKey *key)
+{
+	uint64_t v;
+	size_t bits = key->width * 8;
+
+	switch (key->width) {
+		case 1:
+		{
+			uint8_t k;
+			memcpy(&k, elem + key->offset, 1);
+			v = k;
+			break;
+		}
+		case 2:
+		{
+			uint16_t k;
+			memcpy(&k, elem + key->offset, 2);
+			v = k;
+			break;
+		}
+		case 4:
+		{
+			uint32_t k;
+			memcpy(&k, elem + key->offset, 4);
+			v = k;
+			break;
+		}
+		default:
+			memcpy(&v, elem + key->offset, 8);
+			break;
+	}
+
+	uint64_t sign = 1ULL << (bits - 1);
+
+	if (key->flags & RADIX_FLOAT)
+	{
+		uint64_t mask = (bits == 64) ? ~0ULL : ((1ULL << bits) - 1);
+		v = (v & sign) ? (~v & mask) : (v ^ sign);
+	}
+	else if (key->flags & RADIX_SIGNED)
+		v ^= sign;
+
+	return v;
+}
+
+static int radix_digit_bits(size_t len, const RadixKey *key)
+{
+	if (key->flags & RADIX_DIGIT_8)
+		return 8;
+	if (key->flags & RADIX_DIGIT_11)
+		return 11;
+	if (key->flags & RADIX_DIGIT_16)
+		return 16;
+
+	/* The counts have to stay in the cache, and the passes have to pay for them */
+	if (len < RADIX_SMALL_LEN || key->width <= 2)
+		return 8;
+	if (key->width == 8 && len >= RADIX_LARGE_LEN)
+		return 16;
+
+	return 11;
+}
+
+/* LSD: stable, one histogram pass for all the digits, constant digits are skipped */
+static bool radix_sort_lsd(char *mass, size_t len, const RadixKey *key)
+{
+	int digit_bits = radix_digit_bits(len, key);
+	size_t buckets = (size_t) 1 << digit_bits;
+	uint64_t digit_mask = buckets - 1;
+	int passes = (key->width * 8 + digit_bits - 1) / digit_bits;
+	size_t elemsize = key->elemsize;
+
+	size_t *counts = (size_t*)calloc(passes * buckets, sizeof(size_t));
+	return_val_if_fail(counts != NULL, false);
+
+	char *buf = (char*)malloc(len * elemsize);
+
+	if (buf == NULL)
+	{
+		free(counts);
+		return_val_if_fail(buf != NULL, false);
+	}
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		uint64_t k = radix_key(mass_cell(mass, elemsize, i), key);
+
+		for (int p = 0; p < passes; ++p)
+			counts[p * buckets + ((k >> (p * digit_bits)) & digit_mask)]++;
+	}
+
+	char *src = mass;
+	char *dst = buf;
+
+	for (int p = 0; p < passes; ++p)
+	{
+		size_t *count = &counts[p * buckets];
+		int shift = p * digit_bits;
+
+		/* All the keys have the same digit, nothing to do */
+		if (count[(radix_key(src, key) >> shift) & digit_mask] == len)
+			continue;
+
+		size_t sum = 0;
+
+		for (size_t b = 0; b < buckets; ++b)
+		{
+			size_t c = count[b];
+			count[b] = sum;
+			sum += c;
+		}
+
+		for (size_t i = 0; i < len; ++i)
+		{
+			const char *elem = mass_cell(src, elemsize, i);
+			size_t b = (radix_key(elem, key) >> shift) & digit_mask;
+
+			copy_elem(mass_cell(dst, elemsize, count[b]++), elem, elemsize);
+		}
+
+		char *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != mass)
+		memcpy(mass, src, len * elemsize);
+
+	free(buf);
+	free(counts);
+
+	return true;
+}
+
+static void radix_inssort(char *mass, size_t len, const RadixKey *key, char *tmp)
+{
+	size_t elemsize = key->elemsize;
+
+	for (size_t i = 1; i < len; ++i)
+	{
+		uint64_t k = radix_key(mass_cell(mass, elemsize, i), key);
+
+		if (radix_key(mass_cell(mass, elemsize, i - 1), key) <= k)
+			continue;
+
+		memcpy(tmp, mass_cell(mass, elemsize, i), elemsize);
+
+		size_t j = i - 1;
+
+		while (j > 0 && radix_key(mass_cell(mass, elemsize, j - 1), key) > k)
+			j--;
+
+		memmove(mass_cell(mass, elemsize, j + 1), mass_cell(mass, elemsize, j), (i - j) * elemsize);
+		memcpy(mass_cell(mass, elemsize, j), tmp, elemsize);
+	}
+}
+
+/* MSD American flag sort: the elements are permuted in place by the cycles, byte by byte */
+static void radix_sort_msd(char *mass, size_t len, const RadixKey *key, int shift, char *tmp)
+{
+	size_t elemsize = key->elemsize;
+
+	if (len <= RADIX_INSSORT_THRESHOLD)
+	{
+		radix_inssort(mass, len, key, tmp);
+		return;
+	}
+
+	size_t count[256] = { 0 };
+	size_t next[256];
+	size_t end[256];
+
+	for (size_t i = 0; i < len; ++i)
+		count[(radix_key(mass_cell(mass, elemsize, i), key) >> shift) & 0xFF]++;
+
+	size_t sum = 0;
+
+	for (size_t b = 0; b < 256; ++b)
+	{
+		next[b] = sum;
+		sum += count[b];
+		end[b] = sum;
+	}
+
+	for (size_t b = 0; b < 256; ++b)
+	{
+		while (next[b] < end[b])
+		{
+			char *elem = mass_cell(mass, elemsize, next[b]);
+			size_t d = (radix_key(elem, key) >> shift) & 0xFF;
+
+			if (d == b)
+				next[b]++;
+			else
+				swap_elems(elem, mass_cell(mass, elemsize, next[d]++), elemsize);
+		}
+	}
+
+	if (shift == 0)
+		return;
+
+	size_t start = 0;
+
+	for (size_t b = 0; b < 256; ++b)
+	{
+		if (count[b] > 1)
+			radix_sort_msd(mass_cell(mass, elemsize, start), count[b], key, shift - 8, tmp);
+
+		start += count[b];
+	}
+}
+
+bool radix_sort(void *mass, size_t len, size_t elemsize, size_t key_offset, size_t key_width, RadixFlags flags)
+{
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(key_width == 1 || key_width == 2 || key_width == 4 || key_width == 8, false);
+	arg_return_val_if_fail(key_offset + key_width <= elemsize, false);
+	arg_return_val_if_fail(!(flags & RADIX_FLOAT) || key_width >= 4, false);
+
+	if (len <= 1)
+		return true;
+
+	RadixKey key = {
+		.offset = key_offset,
+		.width = key_width,
+		.elemsize = elemsize,
+		.flags = flags
+	};
+
+	if (!(flags & RADIX_IN_PLACE))
+		return radix_sort_lsd(mass, len, &key);
+
+	char stack_tmp[INSSORT_STACK_ELEM];
+	char *tmp = stack_tmp;
+
+	if (elemsize > INSSORT_STACK_ELEM)
+	{
+		tmp = (char*)malloc(elemsize);
+		return_val_if_fail(tmp != NULL, false);
+	}
+
+	radix_sort_msd(mass, len, &key, (key_width - 1) * 8, tmp);
+
+	if (tmp != stack_tmp)
+		free(tmp);
+
+	return true;
+}
+
+/* }}} */
+
+/* Powersort {{{ */
+
+#define POWERSORT_MIN_GALLOP 7
+#define POWERSORT_MAX_STACK 85
+
+typedef struct
+{
+	size_t elemsize;
+	CmpFunc cmp_func;
+	char *buf; // The smaller run of a merge, or the element of the binary insertion
+	size_t min_gallop;
+	size_t comparisons;
+} StableSort;
+
+typedef struct
+{
+	size_t start;
+	size_t len;
+	int power;
+} StableRun;
+
+static inline bool powersort_less(StableSort *ss, const char *a, const char *b)
+{
+	ss->comparisons++;
+	return ss->cmp_func(a, b) < 0;
+}
+
+/* Sorts [0, n), where [0, start) is sorted already */
+static void powersort_binsort(StableSort *ss, char *mass, size_t n, size_t start)
+{
+	size_t es = ss->elemsize;
+
+	for (size_t i = start; i < n; ++i)
+	{
+		char *pivot = mass_cell(mass, es, i);
+		size_t lo = 0;
+		size_t hi = i;
+
+		while (lo < hi)
+		{
+			size_t mid = lo + ((hi - lo) >> 1);
+
+			if (powersort_less(ss, pivot, mass_cell(mass, es, mid)))
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+
+		if (lo == i)
+			continue;
+
+		copy_elem(ss->buf, pivot, es);
+		memmove(mass_cell(mass, es, lo + 1), mass_cell(mass, es, lo), (i - lo) * es);
+		copy_elem(mass_cell(mass, es, lo), ss->buf, es);
+	}
+}
+
+/* Length of the natural run at the start, a strictly descending one is reversed, a short one is extended */
+static size_t powersort_next_run(StableSort *ss, char *mass, size_t n, size_t minrun)
+{
+	size_t es = ss->elemsize;
+
+	if (n == 1)
+		return 1;
+
+	size_t run = 2;
+
+	if (powersort_less(ss, mass_cell(mass, es, 1), mass))
+	{
+		while (run < n && powersort_less(ss, mass_cell(mass, es, run), mass_cell(mass, es, run - 1)))
+			run++;
+
+		for (size_t i = 0, j = run - 1; i < j; ++i, --j)
+			swap_elems(mass_cell(mass, es, i), mass_cell(mass, es, j), es);
+	}
+	else
+	{
+		while (run < n && !powersort_less(ss, mass_cell(mass, es, run), mass_cell(mass, es, run - 1)))
+			run++;
+	}
+
+	if (run < minrun)
+	{
+		size_t force = (n < minrun) ? n : minrun;
+
+		powersort_binsort(ss, mass, force, run);
+		run = force;
+	}
+
+	return run;
+}
+
+/* Position of key in base[0, n): base[k - 1] < key <= base[k], the search starts at hint */
+static size_t powersort_gallop_left(StableSort *ss, const char *key, const char *base, size_t n, size_t hint)
+{
+	size_t es = ss->elemsize;
+	const char *a = mass_cell(base, es, hint);
+	ssize_t lastofs = 0;
+	ssize_t ofs = 1;
+	ssize_t maxofs;
+
+	if (powersort_less(ss, a, key))
+	{
+		/* base[hint + lastofs] < key <= base[hint + ofs] */
+		maxofs = (ssize_t) (n - hint);
+
+		while (ofs < maxofs && powersort_less(ss, a + ofs * es, key))
+		{
+			lastofs = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+
+		if (ofs > maxofs)
+			ofs = maxofs;
+
+		lastofs += hint;
+		ofs += hint;
+	}
+	else
+	{
+		/* base[hint - ofs] < key <= base[hint - lastofs] */
+		maxofs = (ssize_t) hint + 1;
+
+		while (ofs < maxofs && !powersort_less(ss, a - ofs * es, key))
+		{
+			lastofs = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+
+		if (ofs > maxofs)
+			ofs = maxofs;
+
+		ssize_t k = lastofs;
+		lastofs = (ssize_t) hint - ofs;
+		ofs = (ssize_t) hint - k;
+	}
+
+	for (lastofs++; lastofs < ofs;)
+	{
+		ssize_t m = lastofs + ((ofs - lastofs) >> 1);
+
+		if (powersort_less(ss, mass_cell(base, es, m), key))
+			lastofs = m + 1;
+		else
+			ofs = m;
+	}
+
+	return ofs;
+}
+
+/* Position of key in base[0, n): base[k - 1] <= key < base[k], the search starts at hint */
+static size_t powersort_gallop_right(StableSort *ss, const char *key, const char *base, size_t n, size_t hint)
+{
+	size_t es = ss->elemsize;
+	const char *a = mass_cell(base, es, hint);
+	ssize_t lastofs = 0;
+	ssize_t ofs = 1;
+	ssize_t maxofs;
+
+	if (powersort_less(ss, key, a))
+	{
+		/* base[hint - ofs] <= key < base[hint - lastofs] */
+		maxofs = (ssize_t) hint + 1;
+
+		while (ofs < maxofs && powersort_less(ss, key, a - ofs * es))
+		{
+			lastofs = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+
+		if (ofs > maxofs)
+			ofs = maxofs;
+
+		ssize_t k = lastofs;
+		lastofs = (ssize_t) hint - ofs;
+		ofs = (ssize_t) hint - k;
+	}
+	else
+	{
+		/* base[hint + lastofs] <= key < base[hint + ofs] */
+		maxofs = (ssize_t) (n - hint);
+
+		while (ofs < maxofs && !powersort_less(ss, key, a + ofs * es))
+		{
+			lastofs = ofs;
+			ofs = (ofs << 1) + 1;
+		}
+
+		if (ofs > maxofs)
+			ofs = maxofs;
+
+		lastofs += hint;
+		ofs += hint;
+	}
+
+	for (lastofs++; lastofs < ofs;)
+	{
+		ssize_t m = lastofs + ((ofs - lastofs) >> 1);
+
+		if (powersort_less(ss, key, mass_cell(base, es, m)))
+			ofs = m;
+		else
+			lastofs = m + 1;
+	}
+
+	return ofs;
+}
+
+/*
+ * Merges the runs from the left, na <= nb. The left run is moved to the buffer,
+ * b[0] < a[0] and a[na - 1] goes after all of b (see powersort_merge()).
+ */
+static void powersort_merge_lo(StableSort *ss, char *pa, size_t na, char *pb, size_t nb)
+{
+	size_t es = ss->elemsize;
+	size_t min_gallop = ss->min_gallop;
+	char *dest = pa;
+	char *a = ss->buf;
+	char *b = pb;
+
+	memcpy(a, pa, na * es);
+
+	copy_elem(dest, b, es);
+	dest += es;
+	b += es;
+
+	if (--nb == 0)
+		goto succeed;
+	if (na == 1)
+		goto copy_b;
+
+	while (1)
+	{
+		size_t acount = 0;
+		size_t bcount = 0;
+
+		/* One element at a time, until one of the runs wins too often */
+		while (1)
+		{
+			if (powersort_less(ss, b, a))
+			{
+				copy_elem(dest, b, es);
+				dest += es;
+				b += es;
+				bcount++;
+				acount = 0;
+
+				if (--nb == 0)
+					goto succeed;
+				if (bcount >= min_gallop)
+					break;
+			}
+			else
+			{
+				copy_elem(dest, a, es);
+				dest += es;
+				a += es;
+				acount++;
+				bcount = 0;
+
+				if (--na == 1)
+					goto copy_b;
+				if (acount >= min_gallop)
+					break;
+			}
+		}
+
+		/* Galloping, while it moves long enough parts */
+		min_gallop++;
+
+		do
+		{
+			min_gallop -= (min_gallop > 1);
+			ss->min_gallop = min_gallop;
+
+			size_t k = powersort_gallop_right(ss, b, a, na, 0);
+			acount = k;
+
+			if (k != 0)
+			{
+				memcpy(dest, a, k * es);
+				dest += k * es;
+				a += k * es;
+				na -= k;
+
+				if (na == 1)
+					goto copy_b;
+				if (na == 0)
+					goto succeed;
+			}
+
+			copy_elem(dest, b, es);
+			dest += es;
+			b += es;
+
+			if (--nb == 0)
+				goto succeed;
+
+			k = powersort_gallop_left(ss, a, b, nb, 0);
+			bcount = k;
+
+			if (k != 0)
+			{
+				memmove(dest, b, k * es);
+				dest += k * es;
+				b += k * es;
+				nb -= k;
+
+				if (nb == 0)
+					goto succeed;
+			}
+
+			copy_elem(dest, a, es);
+			dest += es;
+			a += es;
+
+			if (--na == 1)
+				goto copy_b;
+		} while (acount >= POWERSORT_MIN_GALLOP || bcount >= POWERSORT_MIN_GALLOP);
+
+		ss->min_gallop = ++min_gallop;
+	}
+
+succeed:
+	if (na != 0)
+		memcpy(dest, a, na * es);
+
+	return;
+
+copy_b:
+	/* The last element of a goes after the rest of b */
+	memmove(dest, b, nb * es);
+	copy_elem(dest + nb * es, a, es);
+}
+
+/* Merges the runs from the right, nb <= na. The right run is moved to the buffer */
+static void powersort_merge_hi(StableSort *ss, char *pa, size_t na, char *pb, size_t nb)
+{
+	size_t es = ss->elemsize;
+	size_t min_gallop = ss->min_gallop;
+	char *base_a = pa;
+	char *base_b = ss->buf;
+	char *dest = pb + (nb - 1) * es;
+	char *a = pa + (na - 1) * es;
+	char *b = base_b + (nb - 1) * es;
+
+	memcpy(base_b, pb, nb * es);
+
+	copy_elem(dest, a, es);
+	dest -= es;
+	a -= es;
+
+	if (--na == 0)
+		goto succeed;
+	if (nb == 1)
+		goto copy_a;
+
+	while (1)
+	{
+		size_t acount = 0;
+		size_t bcount = 0;
+
+		while (1)
+		{
+			if (powersort_less(ss, b, a))
+			{
+				copy_elem(dest, a, es);
+				dest -= es;
+				a -= es;
+				acount++;
+				bcount = 0;
+
+				if (--na == 0)
+					goto succeed;
+				if (acount >= min_gallop)
+					break;
+			}
+			else
+			{
+				copy_elem(dest, b, es);
+				dest -= es;
+				b -= es;
+				bcount++;
+				acount = 0;
+
+				if (--nb == 1)
+					goto copy_a;
+				if (bcount >= min_gallop)
+					break;
+			}
+		}
+
+		min_gallop++;
+
+		do
+		{
+			min_gallop -= (min_gallop > 1);
+			ss->min_gallop = min_gallop;
+
+			size_t k = na - powersort_gallop_right(ss, b, base_a, na, na - 1);
+			acount = k;
+
+			if (k != 0)
+			{
+				dest -= k * es;
+				a -= k * es;
+				memmove(dest + es, a + es, k * es);
+				na -= k;
+
+				if (na == 0)
+					goto succeed;
+			}
+
+			copy_elem(dest, b, es);
+			dest -= es;
+			b -= es;
+
+			if (--nb == 1)
+				goto copy_a;
+
+			k = nb - powersort_gallop_left(ss, a, base_b, nb, nb - 1);
+			bcount = k;
+
+			if (k != 0)
+			{
+				dest -= k * es;
+				b -= k * es;
+				memcpy(dest + es, b + es, k * es);
+				nb -= k;
+
+				if (nb == 1)
+					goto copy_a;
+				if (nb == 0)
+					goto succeed;
+			}
+
+			copy_elem(dest, a, es);
+			dest -= es;
+			a -= es;
+
+			if (--na == 0)
+				goto succeed;
+		} while (acount >= POWERSORT_MIN_GALLOP || bcount >= POWERSORT_MIN_GALLOP);
+
+		ss->min_gallop = ++min_gallop;
+	}
+
+succeed:
+	if (nb != 0)
+		memcpy(dest - (nb - 1) * es, base_b, nb * es);
+
+	return;
+
+copy_a:
+	/* The first element of b goes before the rest of a */
+	dest -= na * es;
+	a -= na * es;
+	memmove(dest + es, a + es, na * es);
+	copy_elem(dest, b, es);
+}
+
+/* Merges the adjacent runs, the parts which are in place already are skipped */
+static void powersort_merge(StableSort *ss, char *pa, size_t na, size_t nb)
+{
+	size_t es = ss->elemsize;
+	char *pb = pa + na * es;
+
+	size_t k = powersort_gallop_right(ss, pb, pa, na, 0);
+	pa += k * es;
+	na -= k;
+
+	if (na == 0)
+		return;
+
+	nb = powersort_gallop_left(ss, pa + (na - 1) * es, pb, nb, nb - 1);
+
+	if (nb == 0)
+		return;
+
+	if (na <= nb)
+		powersort_merge_lo(ss, pa, na, pb, nb);
+	else
+		powersort_merge_hi(ss, pa, na, pb, nb);
+}
+
+/* Depth of the boundary between the runs in the perfectly balanced merge tree of [0, n) */
+static int powersort_power(size_t s1, size_t n1, size_t n2, size_t n)
+{
+	int power = 0;
+	size_t a = 2 * s1 + n1;
+	size_t b = a + n1 + n2;
+
+	while (1)
+	{
+		power++;
+
+		if (a >= n)
+		{
+			a -= n;
+			b -= n;
+		}
+		else if (b >= n)
+			break;
+
+		a <<= 1;
+		b <<= 1;
+	}
+
+	return power;
+}
+
+static size_t powersort_minrun(size_t n)
+{
+	size_t r = 0;
+
+	while (n >= 64)
+	{
+		r |= n & 1;
+		n >>= 1;
+	}
+
+	return n + r;
+}
+
+/* buf has to hold len / 2 + 1 elements */
+static void powersort_buf(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func, char *buf, size_t *comparisons)
+{
+	StableSort ss = {
+		.elemsize = elemsize,
+		.cmp_func = cmp_func,
+		.buf = buf,
+		.min_gallop = POWERSORT_MIN_GALLOP,
+		.comparisons = 0
+	};
+
+	StableRun stack[POWERSORT_MAX_STACK];
+	size_t top = 0;
+	size_t minrun = powersort_minrun(len);
+
+	size_t start = 0;
+	size_t run = powersort_next_run(&ss, mass, len, minrun);
+
+	while (start + run < len)
+	{
+		size_t start2 = start + run;
+		size_t run2 = powersort_next_run(&ss, mass_cell(mass, elemsize, start2), len - start2, minrun);
+		int power = powersort_power(start, run, run2, len);
+
+		while (top > 0 && stack[top - 1].power > power)
+		{
+			top--;
+			powersort_merge(&ss, mass_cell(mass, elemsize, stack[top].start), stack[top].len, run);
+			start = stack[top].start;
+			run += stack[top].len;
+		}
+
+		stack[top++] = (StableRun) { .start = start, .len = run, .power = power };
+
+		start = start2;
+		run = run2;
+	}
+
+	while (top > 0)
+	{
+		top--;
+		powersort_merge(&ss, mass_cell(mass, elemsize, stack[top].start), stack[top].len, run);
+		run += stack[top].len;
+	}
+
+	if (comparisons != NULL)
+		*comparisons = ss.comparisons;
+}
+
+bool powersort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func, size_t *comparisons)
+{
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
+
+	if (comparisons != NULL)
+		*comparisons = 0;
+
+	if (len <= 1)
+		return true;
+
+	char *buf = (char*)malloc((len / 2 + 1) * elemsize);
+	return_val_if_fail(buf != NULL, false);
+
+	powersort_buf(mass, len, elemsize, cmp_func, buf, comparisons);
+	free(buf);
+
+	return true;
+}
+
+/* }}} */
+
+/* Parallel sort {{{ */
+
+#define PARALLEL_SORT_MIN_CHUNK 8192
+#define PARALLEL_SORT_PIECES 4 // Pieces of every merge round per worker
+
+typedef struct
+{
+	size_t start; // First element of the left run
+	size_t mid;   // First element of the right run, end if there is only one run
+	size_t end;
+	size_t k0;    // Part of the merged output [start + k0, start + k1)
+	size_t k1;
+} SortTask;
+
+typedef struct _SortPool SortPool;
+typedef void (*SortTaskFunc)(SortPool *pool, const SortTask *task);
+
+struct _SortPool
+{
+	char *src;
+	char *dst;
+	size_t elemsize;
+	CmpFunc cmp_func;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done_cond;
+
+	SortTaskFunc func;
+	SortTask *tasks;
+	size_t ntasks;
+	size_t next;
+	size_t done;
+	bool stop;
+};
+
+/* Number of the elements of a among the first k elements of the stable merge of a and b */
+static size_t merge_corank(const char *a, size_t a_len, const char *b, size_t b_len, size_t k,
+                           size_t elemsize, CmpFunc cmp_func)
+{
+	size_t lo = (k > b_len) ? (k - b_len) : 0;
+	size_t hi = (k < a_len) ? k : a_len;
+
+	while (lo < hi)
+	{
+		size_t i = lo + ((hi - lo) >> 1);
+
+		/* a[i] goes after b[k - i - 1], so it isn't among the first k */
+		if (cmp_func(mass_cell(a, elemsize, i), mass_cell(b, elemsize, k - i - 1)) > 0)
+			hi = i;
+		else
+			lo = i + 1;
+	}
+
+	return lo;
+}
+
+/* Stable merge of [k0, k1) of the merged a and b into dst, equal elements are taken from a first */
+static void merge_range(const char *a, size_t a_len, const char *b, size_t b_len, char *dst,
+                        size_t k0, size_t k1, size_t elemsize, CmpFunc cmp_func)
+{
+	size_t i = merge_corank(a, a_len, b, b_len, k0, elemsize, cmp_func);
+	size_t j = k0 - i;
+
+	for (size_t k = k0; k < k1; ++k)
+	{
+		const char *from;
+
+		if (j >= b_len || (i < a_len && cmp_func(mass_cell(a, elemsize, i), mass_cell(b, elemsize, j)) <= 0))
+			from = mass_cell(a, elemsize, i++);
+		else
+			from = mass_cell(b, elemsize, j++);
+
+		copy_elem(mass_cell(dst, elemsize, k), from, elemsize);
+	}
+}
+
+static void sort_task_quicksort(SortPool *pool, const SortTask *task)
+{
+	quicksort(mass_cell(pool->src, pool->elemsize, task->start), task->end - task->start,
+	          pool->elemsize, pool->cmp_func);
+}
+
+static void sort_task_powersort(SortPool *pool, const SortTask *task)
+{
+	powersort_buf(mass_cell(pool->src, pool->elemsize, task->start), task->end - task->start, pool->elemsize,
+	              pool->cmp_func, mass_cell(pool->dst, pool->elemsize, task->start), NULL);
+}
+
+static void sort_task_merge(SortPool *pool, const SortTask *task)
+{
+	size_t elemsize = pool->elemsize;
+
+	merge_range(mass_cell(pool->src, elemsize, task->start), task->mid - task->start,
+	            mass_cell(pool->src, elemsize, task->mid), task->end - task->mid,
+	            mass_cell(pool->dst, elemsize, task->start), task->k0, task->k1, elemsize, pool->cmp_func);
+}
+
+/* Takes the tasks of the current round until there are none, the lock is held */
+static void sort_pool_run(SortPool *pool)
+{
+	while (pool->next < pool->ntasks)
+	{
+		const SortTask *task = &pool->tasks[pool->next++];
+
+		pthread_mutex_unlock(&pool->lock);
+		pool->func(pool, task);
+		pthread_mutex_lock(&pool->lock);
+
+		if (++pool->done == pool->ntasks)
+			pthread_cond_broadcast(&pool->done_cond);
+	}
+}
+
+static void* sort_pool_worker(void *data)
+{
+	SortPool *pool = (SortPool*)data;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (!pool->stop)
+	{
+		sort_pool_run(pool);
+
+		if (!pool->stop)
+			pthread_cond_wait(&pool->work, &pool->lock);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* Runs the tasks by the workers and the calling thread, returns when all of them are done */
+static void sort_pool_round(SortPool *pool, SortTaskFunc func, SortTask *tasks, size_t ntasks)
+{
+	pthread_mutex_lock(&pool->lock);
+
+	pool->func = func;
+	pool->tasks = tasks;
+	pool->ntasks = ntasks;
+	pool->next = 0;
+	pool->done = 0;
+
+	pthread_cond_broadcast(&pool->work);
+	sort_pool_run(pool);
+
+	while (pool->done < pool->ntasks)
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void parallel_sort_pool(SortPool *pool, size_t len, size_t nchunks, size_t workers, ParallelSortFlags flags,
+                               SortTask *tasks, size_t *runs)
+{
+	/* Every chunk is sorted in place */
+	for (size_t c = 0; c < nchunks; ++c)
+	{
+		runs[c] = len * c / nchunks;
+		tasks[c] = (SortTask) { .start = runs[c], .end = len * (c + 1) / nchunks };
+	}
+
+	runs[nchunks] = len;
+
+	sort_pool_round(pool, (flags & PARALLEL_SORT_STABLE) ? sort_task_powersort : sort_task_quicksort, tasks, nchunks);
+
+	/* Pairs of the runs are merged, each merge is cut into the pieces by the co-ranks */
+	size_t piece = len / (workers * PARALLEL_SORT_PIECES) + 1;
+	size_t nruns = nchunks;
+
+	while (nruns > 1)
+	{
+		size_t ntasks = 0;
+		size_t npairs = 0;
+
+		for (size_t r = 0; r < nruns; r += 2)
+		{
+			size_t start = runs[r];
+			size_t mid = runs[r + 1];
+			size_t end = runs[(r + 2 < nruns) ? (r + 2) : nruns];
+
+			for (size_t k = 0; k < end - start; k += piece)
+			{
+				tasks[ntasks++] = (SortTask) {
+					.start = start,
+					.mid = mid,
+					.end = end,
+					.k0 = k,
+					.k1 = (end - start - k < piece) ? (end - start) : (k + piece)
+				};
+			}
+
+			runs[npairs++] = start;
+		}
+
+		runs[npairs] = len;
+		nruns = npairs;
+
+		sort_pool_round(pool, sort_task_merge, tasks, ntasks);
+
+		char *tmp = pool->src;
+		pool->src = pool->dst;
+		pool->dst = tmp;
+	}
+}
+
+size_t parallel_sort_get_default_workers(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (size_t) n : 1;
+}
+
+bool parallel_sort(void *mass, size_t len, size_t elemsize, CmpFunc cmp_func, size_t workers, ParallelSortFlags flags)
+{
+	arg_return_val_if_fail(mass != NULL, false);
+	arg_return_val_if_fail(cmp_func != NULL, false);
+	arg_return_val_if_fail(elemsize != 0, false);
+
+	if (len <= 1)
+		return true;
+
+	if (workers == 0)
+		workers = parallel_sort_get_default_workers();
+
+	if (workers > len / PARALLEL_SORT_MIN_CHUNK)
+		workers = len / PARALLEL_SORT_MIN_CHUNK;
+
+	if (len < PARALLEL_SORT_THRESHOLD || workers <= 1)
+	{
+		if (!(flags & PARALLEL_SORT_STABLE))
+		{
+			quicksort(mass, len, elemsize, cmp_func);
+			return true;
+		}
+
+		return powersort(mass, len, elemsize, cmp_func, NULL);
+	}
+
+	size_t nchunks = workers;
+	char *buf = (char*)malloc(len * elemsize);
+	SortTask *tasks = (SortTask*)malloc((nchunks + workers * PARALLEL_SORT_PIECES + 1) * sizeof(SortTask));
+	size_t *runs = (size_t*)malloc((nchunks + 1) * sizeof(size_t));
+	pthread_t *threads = (pthread_t*)malloc(workers * sizeof(pthread_t));
+
+	if (buf == NULL || tasks == NULL || runs == NULL || threads == NULL)
+	{
+		free(buf);
+		free(tasks);
+		free(runs);
+		free(threads);
+		msg_error("couldn't allocate memory for the parallel sort!");
+		return false;
+	}
+
+	SortPool pool = {
+		.src = mass,
+		.dst = buf,
+		.elemsize = elemsize,
+		.cmp_func = cmp_func
+	};
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.work, NULL);
+	pthread_cond_init(&pool.done_cond, NULL);
+
+	/* The calling thread is a worker too, the rounds are finished even if no thread has started */
+	size_t nthreads = 0;
+
+	while (nthreads < workers - 1 && pthread_create(&threads[nthreads], NULL, sort_pool_worker, &pool) == 0)
+		nthreads++;
+
+	parallel_sort_pool(&pool, len, nchunks, workers, flags, tasks, runs);
+
+	pthread_mutex_lock(&pool.lock);
+	pool.stop = true;
+	pthread_cond_broadcast(&pool.work);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (size_t i = 0; i < nthreads; ++i)
+		pthread_join(threads[i], NULL);
+
+	if (pool.src != mass)
+		memcpy(mass, pool.src, len * elemsize);
+
+	pthread_cond_destroy(&pool.done_cond);
+	pthread_cond_destroy(&pool.work);
+	pthread_mutex_destroy(&pool.lock);
+
+	free(threads);
+	free(runs);
+	free(tasks);
+	free(buf);
+
+	return true;
+}
+
+/* }}} */
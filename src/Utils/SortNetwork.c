@@ -0,0 +1,463 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+#include "Utils/Sort.h"
+#include "Utils/SortTemplate.h"
+#include "Base/Macros.h"
+#include "Base/Messages.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SORT_NETWORK_X86
+#include <immintrin.h>
+#endif
+
+static atomic_int sort_isa = SORT_ISA_AUTO;
+
+/* Scalar paths {{{ */
+
+SORT_DEFINE(small_i32, int32_t, a < b)
+SORT_DEFINE(small_i64, int64_t, a < b)
+SORT_DEFINE(small_f32, float, a < b)
+
+/* }}} */
+
+/*
+ * Bitonic sorting network of the vectors, in the form where every comparator
+ * is ascending: for the blocks of 2k elements the element i is compared with
+ * i ^ (2k - 1) (the mirror step), then with i ^ j for j = k / 2, ..., 1.
+ * The keys are padded up to the power of two with the greatest value.
+ *
+ * The prefix has to provide the vector operations:
+ *   load(const type*), store(type*, vec)
+ *   permute(vec, x)             lane l gets the lane l ^ x
+ *   minmax(vec, vec, vec*, vec*)
+ *   exchange(vec, x, bit)       the lanes l and l ^ x are exchanged if they are out of order,
+ *                               l being the lower one if (l & bit) == 0
+ */
+#define SORT_NETWORK_DEFINE(prefix, type, vec, lanes, pad, attr)                        \
+	attr static void prefix##_network(type *mass, size_t len)                           \
+	{                                                                                   \
+		type buf[SORT_SMALL_MAX];                                                       \
+		vec v[SORT_SMALL_MAX / (lanes)];                                                \
+		size_t n = (lanes);                                                             \
+                                                                                        \
+		while (n < len)                                                                 \
+			n <<= 1;                                                                    \
+                                                                                        \
+		size_t nv = n / (lanes);                                                        \
+                                                                                        \
+		memcpy(buf, mass, len * sizeof(type));                                          \
+                                                                                        \
+		for (size_t i = len; i < n; ++i)                                                \
+			buf[i] = (pad);                                                             \
+                                                                                        \
+		for (size_t i = 0; i < nv; ++i)                                                 \
+			v[i] = prefix##_load(&buf[i * (lanes)]);                                    \
+                                                                                        \
+		for (size_t k = 1; k < n; k <<= 1)                                              \
+		{                                                                               \
+			if ((k << 1) <= (lanes))                                                    \
+			{                                                                           \
+				for (size_t i = 0; i < nv; ++i)                                         \
+				{                                                                       \
+					v[i] = prefix##_exchange(v[i], (k << 1) - 1, k);                    \
+				}                                                                       \
+			}                                                                           \
+			else                                                                        \
+			{                                                                           \
+				/* The mirror of the lane l of the vector a is the lane lanes - 1 - l of b */ \
+				size_t span = (k << 1) / (lanes);                                       \
+                                                                                        \
+				for (size_t base = 0; base < nv; base += span)                          \
+				{                                                                       \
+					for (size_t a = base; a < base + span / 2; ++a)                     \
+					{                                                                   \
+						size_t b = (base << 1) + span - 1 - a;                          \
+						vec lo, hi;                                                     \
+						prefix##_minmax(v[a], prefix##_permute(v[b], (lanes) - 1), &lo, &hi); \
+						v[a] = lo;                                                      \
+						v[b] = prefix##_permute(hi, (lanes) - 1);                       \
+					}                                                                   \
+				}                                                                       \
+			}                                                                           \
+                                                                                        \
+			for (size_t j = k >> 1; j > 0; j >>= 1)                                     \
+			{                                                                           \
+				if (j >= (lanes))                                                       \
+				{                                                                       \
+					size_t jv = j / (lanes);                                            \
+                                                                                        \
+					for (size_t i = 0; i < nv; ++i)                                     \
+						if ((i & jv) == 0)                                              \
+							prefix##_minmax(v[i], v[i + jv], &v[i], &v[i + jv]);        \
+				}                                                                       \
+				else                                                                    \
+				{                                                                       \
+					for (size_t i = 0; i < nv; ++i)                                     \
+						v[i] = prefix##_exchange(v[i], j, j);                           \
+				}                                                                       \
+			}                                                                           \
+		}                                                                               \
+                                                                                        \
+		for (size_t i = 0; i < nv; ++i)                                                 \
+			prefix##_store(&buf[i * (lanes)], v[i]);                                    \
+                                                                                        \
+		memcpy(mass, buf, len * sizeof(type));                                          \
+	}
+
+#ifdef SORT_NETWORK_X86
+
+#define AVX2_FUNC __attribute__((target("avx2")))
+#define SSE41_FUNC __attribute__((target("sse4.1")))
+
+/* AVX2 {{{ */
+
+/*
+ * Lanes of b where mask is set, of a otherwise. Not _mm256_blendv_epi8(), which
+ * GCC folds into a comparison of chars with zero, and it's never true with -funsigned-char.
+ */
+AVX2_FUNC static inline __m256i avx2_blend(__m256i a, __m256i b, __m256i mask)
+{
+	return _mm256_or_si256(_mm256_and_si256(mask, b), _mm256_andnot_si256(mask, a));
+}
+
+AVX2_FUNC static inline __m256i avx2_iota32(void)
+{
+	return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+}
+
+/* Mask of the lanes of 32 bits, where (l & bit) == 0 */
+AVX2_FUNC static inline __m256i avx2_lo_mask32(int bit)
+{
+	return _mm256_cmpeq_epi32(_mm256_and_si256(avx2_iota32(), _mm256_set1_epi32(bit)), _mm256_setzero_si256());
+}
+
+AVX2_FUNC static inline __m256i avx2_i32_load(const int32_t *p)
+{
+	return _mm256_loadu_si256((const __m256i*) p);
+}
+
+AVX2_FUNC static inline void avx2_i32_store(int32_t *p, __m256i v)
+{
+	_mm256_storeu_si256((__m256i*) p, v);
+}
+
+AVX2_FUNC static inline __m256i avx2_i32_permute(__m256i v, int x)
+{
+	return _mm256_permutevar8x32_epi32(v, _mm256_xor_si256(avx2_iota32(), _mm256_set1_epi32(x)));
+}
+
+AVX2_FUNC static inline void avx2_i32_minmax(__m256i a, __m256i b, __m256i *lo, __m256i *hi)
+{
+	*lo = _mm256_min_epi32(a, b);
+	*hi = _mm256_max_epi32(a, b);
+}
+
+AVX2_FUNC static inline __m256i avx2_i32_select(__m256i lo, __m256i hi, int bit)
+{
+	return avx2_blend(hi, lo, avx2_lo_mask32(bit));
+}
+
+AVX2_FUNC static inline __m256i avx2_i32_exchange(__m256i v, int x, int bit)
+{
+	__m256i lo, hi;
+
+	avx2_i32_minmax(v, avx2_i32_permute(v, x), &lo, &hi);
+
+	return avx2_i32_select(lo, hi, bit);
+}
+
+AVX2_FUNC static inline __m256i avx2_i64_load(const int64_t *p)
+{
+	return _mm256_loadu_si256((const __m256i*) p);
+}
+
+AVX2_FUNC static inline void avx2_i64_store(int64_t *p, __m256i v)
+{
+	_mm256_storeu_si256((__m256i*) p, v);
+}
+
+/* The lane of 64 bits l is the pair of 32 bits 2l, 2l + 1, so the index is xored by 2x */
+AVX2_FUNC static inline __m256i avx2_i64_permute(__m256i v, int x)
+{
+	return _mm256_permutevar8x32_epi32(v, _mm256_xor_si256(avx2_iota32(), _mm256_set1_epi32(x << 1)));
+}
+
+/* There are no min and max of 64 bits in AVX2 */
+AVX2_FUNC static inline void avx2_i64_minmax(__m256i a, __m256i b, __m256i *lo, __m256i *hi)
+{
+	__m256i gt = _mm256_cmpgt_epi64(a, b);
+
+	*lo = avx2_blend(a, b, gt);
+	*hi = avx2_blend(b, a, gt);
+}
+
+AVX2_FUNC static inline __m256i avx2_i64_select(__m256i lo, __m256i hi, int bit)
+{
+	__m256i mask = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_setr_epi64x(0, 1, 2, 3), _mm256_set1_epi64x(bit)),
+	                                  _mm256_setzero_si256());
+
+	return avx2_blend(hi, lo, mask);
+}
+
+AVX2_FUNC static inline __m256i avx2_i64_exchange(__m256i v, int x, int bit)
+{
+	__m256i lo, hi;
+
+	avx2_i64_minmax(v, avx2_i64_permute(v, x), &lo, &hi);
+
+	return avx2_i64_select(lo, hi, bit);
+}
+
+AVX2_FUNC static inline __m256 avx2_f32_load(const float *p)
+{
+	return _mm256_loadu_ps(p);
+}
+
+AVX2_FUNC static inline void avx2_f32_store(float *p, __m256 v)
+{
+	_mm256_storeu_ps(p, v);
+}
+
+AVX2_FUNC static inline __m256 avx2_f32_permute(__m256 v, int x)
+{
+	return _mm256_permutevar8x32_ps(v, _mm256_xor_si256(avx2_iota32(), _mm256_set1_epi32(x)));
+}
+
+/* By the comparison and not by min and max, which would turn -0.0 into 0.0 */
+AVX2_FUNC static inline void avx2_f32_minmax(__m256 a, __m256 b, __m256 *lo, __m256 *hi)
+{
+	__m256 lt = _mm256_cmp_ps(b, a, _CMP_LT_OQ);
+
+	*lo = _mm256_blendv_ps(a, b, lt);
+	*hi = _mm256_blendv_ps(b, a, lt);
+}
+
+/*
+ * Both lanes of a pair have to make the same decision, or one of the equal keys
+ * (-0.0 and 0.0) would be duplicated: they are swapped if the upper is less.
+ */
+AVX2_FUNC static inline __m256 avx2_f32_exchange(__m256 v, int x, int bit)
+{
+	__m256 p = avx2_f32_permute(v, x);
+	__m256 lo_lanes = _mm256_castsi256_ps(avx2_lo_mask32(bit));
+	__m256 swap = _mm256_blendv_ps(_mm256_cmp_ps(v, p, _CMP_LT_OQ), _mm256_cmp_ps(p, v, _CMP_LT_OQ), lo_lanes);
+
+	return _mm256_blendv_ps(v, p, swap);
+}
+
+SORT_NETWORK_DEFINE(avx2_i32, int32_t, __m256i, 8, INT32_MAX, AVX2_FUNC)
+SORT_NETWORK_DEFINE(avx2_i64, int64_t, __m256i, 4, INT64_MAX, AVX2_FUNC)
+SORT_NETWORK_DEFINE(avx2_f32, float, __m256, 8, INFINITY, AVX2_FUNC)
+
+/* }}} */
+
+/* SSE4.1 {{{ */
+
+/* See avx2_blend() */
+SSE41_FUNC static inline __m128i sse41_blend(__m128i a, __m128i b, __m128i mask)
+{
+	return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+/* pshufb indices of the lanes of 32 bits: the byte b of the lane l comes from 4 (l ^ x) + b */
+SSE41_FUNC static inline __m128i sse41_permute_mask32(int x)
+{
+	return _mm_xor_si128(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+	                     _mm_set1_epi8((char) (x << 2)));
+}
+
+SSE41_FUNC static inline __m128i sse41_lo_mask32(int bit)
+{
+	return _mm_cmpeq_epi32(_mm_and_si128(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(bit)), _mm_setzero_si128());
+}
+
+SSE41_FUNC static inline __m128i sse41_i32_load(const int32_t *p)
+{
+	return _mm_loadu_si128((const __m128i*) p);
+}
+
+SSE41_FUNC static inline void sse41_i32_store(int32_t *p, __m128i v)
+{
+	_mm_storeu_si128((__m128i*) p, v);
+}
+
+SSE41_FUNC static inline __m128i sse41_i32_permute(__m128i v, int x)
+{
+	return _mm_shuffle_epi8(v, sse41_permute_mask32(x));
+}
+
+SSE41_FUNC static inline void sse41_i32_minmax(__m128i a, __m128i b, __m128i *lo, __m128i *hi)
+{
+	*lo = _mm_min_epi32(a, b);
+	*hi = _mm_max_epi32(a, b);
+}
+
+SSE41_FUNC static inline __m128i sse41_i32_select(__m128i lo, __m128i hi, int bit)
+{
+	return sse41_blend(hi, lo, sse41_lo_mask32(bit));
+}
+
+SSE41_FUNC static inline __m128i sse41_i32_exchange(__m128i v, int x, int bit)
+{
+	__m128i lo, hi;
+
+	sse41_i32_minmax(v, sse41_i32_permute(v, x), &lo, &hi);
+
+	return sse41_i32_select(lo, hi, bit);
+}
+
+SSE41_FUNC static inline __m128 sse41_f32_load(const float *p)
+{
+	return _mm_loadu_ps(p);
+}
+
+SSE41_FUNC static inline void sse41_f32_store(float *p, __m128 v)
+{
+	_mm_storeu_ps(p, v);
+}
+
+SSE41_FUNC static inline __m128 sse41_f32_permute(__m128 v, int x)
+{
+	return _mm_castsi128_ps(_mm_shuffle_epi8(_mm_castps_si128(v), sse41_permute_mask32(x)));
+}
+
+SSE41_FUNC static inline void sse41_f32_minmax(__m128 a, __m128 b, __m128 *lo, __m128 *hi)
+{
+	__m128 lt = _mm_cmplt_ps(b, a);
+
+	*lo = _mm_blendv_ps(a, b, lt);
+	*hi = _mm_blendv_ps(b, a, lt);
+}
+
+/* See avx2_f32_exchange() */
+SSE41_FUNC static inline __m128 sse41_f32_exchange(__m128 v, int x, int bit)
+{
+	__m128 p = sse41_f32_permute(v, x);
+	__m128 lo_lanes = _mm_castsi128_ps(sse41_lo_mask32(bit));
+	__m128 swap = _mm_blendv_ps(_mm_cmplt_ps(v, p), _mm_cmplt_ps(p, v), lo_lanes);
+
+	return _mm_blendv_ps(v, p, swap);
+}
+
+SORT_NETWORK_DEFINE(sse41_i32, int32_t, __m128i, 4, INT32_MAX, SSE41_FUNC)
+SORT_NETWORK_DEFINE(sse41_f32, float, __m128, 4, INFINITY, SSE41_FUNC)
+
+/* }}} */
+
+#endif /* SORT_NETWORK_X86 */
+
+static SortIsa sort_small_best_isa(void)
+{
+#ifdef SORT_NETWORK_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return SORT_ISA_AVX2;
+	else if (__builtin_cpu_supports("sse4.1"))
+		return SORT_ISA_SSE41;
+#endif
+
+	return SORT_ISA_SCALAR;
+}
+
+static SortIsa sort_small_isa(void)
+{
+	int isa = atomic_load_explicit(&sort_isa, memory_order_relaxed);
+
+	if (isa != SORT_ISA_AUTO)
+		return isa;
+
+	isa = sort_small_best_isa();
+	atomic_store_explicit(&sort_isa, isa, memory_order_relaxed);
+
+	return isa;
+}
+
+bool sort_small_set_isa(SortIsa isa)
+{
+	arg_return_val_if_fail(isa >= SORT_ISA_AUTO && isa <= SORT_ISA_AVX2, false);
+
+	if (isa > sort_small_best_isa())
+		return false;
+
+	atomic_store_explicit(&sort_isa, isa, memory_order_relaxed);
+
+	return true;
+}
+
+void sort_small_i32(int32_t *mass, size_t len)
+{
+	arg_return_if_fail(len <= SORT_SMALL_MAX);
+
+	if (len <= 1)
+		return;
+
+	switch (sort_small_isa()) {
+#ifdef SORT_NETWORK_X86
+		case SORT_ISA_AVX2:
+			avx2_i32_network(mass, len);
+			return;
+		case SORT_ISA_SSE41:
+			sse41_i32_network(mass, len);
+			return;
+#endif
+		default:
+			small_i32_inssort(mass, len);
+			return;
+	}
+}
+
+/* The lanes of 64 bits need pcmpgtq, so there is no SSE4.1 network */
+void sort_small_i64(int64_t *mass, size_t len)
+{
+	arg_return_if_fail(len <= SORT_SMALL_MAX);
+
+	if (len <= 1)
+		return;
+
+	switch (sort_small_isa()) {
+#ifdef SORT_NETWORK_X86
+		case SORT_ISA_AVX2:
+			avx2_i64_network(mass, len);
+			return;
+#endif
+		default:
+			small_i64_inssort(mass, len);
+			return;
+	}
+}
+
+/* NaNs would be sorted after the padding and lost, such keys take the scalar path */
+void sort_small_f32(float *mass, size_t len)
+{
+	arg_return_if_fail(len <= SORT_SMALL_MAX);
+
+	if (len <= 1)
+		return;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		if (isnan(mass[i]))
+		{
+			small_f32_inssort(mass, len);
+			return;
+		}
+	}
+
+	switch (sort_small_isa()) {
+#ifdef SORT_NETWORK_X86
+		case SORT_ISA_AVX2:
+			avx2_f32_network(mass, len);
+			return;
+		case SORT_ISA_SSE41:
+			sse41_f32_network(mass, len);
+			return;
+#endif
+		default:
+			small_f32_inssort(mass, len);
+			return;
+	}
+}
@@ -3,6 +3,7 @@
 #include <time.h>
 #include <limits.h>
 #include <string.h>
+#include <stddef.h>
 
 #include "Base.h"
 #include "DataStructs/Array.h"
@@ -23,12 +24,12 @@ int test_array_cmp(const void *a, const void *b)
 
 Array* test_array_new(void)
 {
-	return array_new(false, false, sizeof(TestArray), NULL);
+	return array_new_with_key(false, false, sizeof(TestArray), NULL, SEARCH_KEY_INT32, offsetof(TestArray, key));
 }
 
 bool test_array_find(const Array *arr, int key, size_t *index)
 {
-	return array_linear_search(arr, GET_PTR(TestArray, key, 0), test_array_cmp, index);
+	return array_linear_search(arr, GET_PTR(TestArray, key, 0), NULL, index);
 }
 
 void test_array_set(Array *arr, int key, int value)
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "Base.h"
+#include "Utils/ExternalSort.h"
+
+/* Inputs of 4 memory budgets are sorted under the small budgets, the output has to be ordered and complete */
+
+typedef struct _Record
+{
+	uint64_t key;
+	uint64_t seq;
+	uint32_t value;
+} Record;
+
+typedef struct
+{
+	size_t count;
+	uint64_t prev_key;
+	uint64_t seq_sum;
+	uint64_t key_xor;
+	size_t misordered;
+} Check;
+
+int record_cmp(const void *a, const void *b)
+{
+	const Record *ra = a;
+	const Record *rb = b;
+
+	return (ra->key > rb->key) - (ra->key < rb->key);
+}
+
+uint64_t rand64(void)
+{
+	return ((uint64_t) rand() << 62) ^ ((uint64_t) rand() << 31) ^ (uint64_t) rand();
+}
+
+void check_records(Check *check, const Record *recs, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (check->count > 0 && recs[i].key < check->prev_key)
+			check->misordered++;
+
+		check->prev_key = recs[i].key;
+		check->seq_sum += recs[i].seq;
+		check->key_xor ^= recs[i].key;
+		check->count++;
+	}
+}
+
+bool check_output(Check *check, const char *name, size_t len, uint64_t key_xor)
+{
+	bool res = (check->count == len && check->misordered == 0 &&
+	            check->seq_sum == (uint64_t) len * (len - 1) / 2 && check->key_xor == key_xor);
+
+	printf("%s: %lu of %lu records, %lu misordered, %s\n", name, check->count, len,
+			check->misordered, (res) ? "ok" : "FAILED");
+
+	return res;
+}
+
+/* A temporary file of len random records */
+int make_input(size_t len, bool few_keys, uint64_t *key_xor)
+{
+	FILE *f = tmpfile();
+	exit_if_fail(f != NULL);
+
+	*key_xor = 0;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		Record rec = {
+			.key = (few_keys) ? ((uint64_t) rand() % 16) : (rand64()),
+			.seq = i,
+			.value = (uint32_t) rand()
+		};
+
+		*key_xor ^= rec.key;
+		exit_if_fail(fwrite(&rec, sizeof(Record), 1, f) == 1);
+	}
+
+	exit_if_fail(fflush(f) == 0);
+
+	int fd = dup(fileno(f));
+	exit_if_fail(fd >= 0);
+	exit_if_fail(lseek(fd, 0, SEEK_SET) == 0);
+
+	fclose(f);
+
+	return fd;
+}
+
+bool test_to_file(const char *name, const ExternalSortParams *params, bool few_keys)
+{
+	size_t len = 4 * params->memory_budget / sizeof(Record);
+	uint64_t key_xor;
+
+	int in_fd = make_input(len, few_keys, &key_xor);
+
+	FILE *out = tmpfile();
+	exit_if_fail(out != NULL);
+
+	bool sorted = external_sort(in_fd, fileno(out), params);
+	close(in_fd);
+
+	Check check = { 0 };
+	Record recs[256];
+	size_t n;
+
+	rewind(out);
+
+	while ((n = fread(recs, sizeof(Record), 256, out)) > 0)
+		check_records(&check, recs, n);
+
+	fclose(out);
+
+	return sorted && check_output(&check, name, len, key_xor);
+}
+
+bool output_func(const void *records, size_t count, void *userdata)
+{
+	check_records(userdata, records, count);
+	return true;
+}
+
+bool test_to_func(const char *name, const ExternalSortParams *params)
+{
+	size_t len = 4 * params->memory_budget / sizeof(Record);
+	uint64_t key_xor;
+
+	int in_fd = make_input(len, false, &key_xor);
+
+	Check check = { 0 };
+	bool sorted = external_sort_with_func(in_fd, params, output_func, &check);
+	close(in_fd);
+
+	return sorted && check_output(&check, name, len, key_xor);
+}
+
+/* The output can't be written, the sort has to fail instead of going on */
+bool test_failed_write(const char *name, const ExternalSortParams *params)
+{
+	size_t len = 4 * params->memory_budget / sizeof(Record);
+	uint64_t key_xor;
+
+	int in_fd = make_input(len, false, &key_xor);
+	int out_fd = open("/dev/null", O_RDONLY);
+	exit_if_fail(out_fd >= 0);
+
+	bool sorted = external_sort(in_fd, out_fd, params);
+
+	close(out_fd);
+	close(in_fd);
+
+	printf("%s: %s\n", name, (sorted) ? "FAILED" : "ok");
+
+	return !sorted;
+}
+
+int main(int argc, char *argv[])
+{
+	bool ok = true;
+
+	srand(1);
+
+	/* The fan-in is 3 at 256 KB, so the runs take more than one merge pass */
+	ok &= test_to_file("quicksort runs, 256 KB budget", &(ExternalSortParams) {
+			.elemsize = sizeof(Record),
+			.cmp_func = record_cmp,
+			.memory_budget = 256 << 10
+	}, false);
+
+	ok &= test_to_file("quicksort runs, 16 keys, 1 MB budget", &(ExternalSortParams) {
+			.elemsize = sizeof(Record),
+			.cmp_func = record_cmp,
+			.memory_budget = 1 << 20
+	}, true);
+
+	ok &= test_to_file("radix runs, O_DIRECT, 1 MB budget", &(ExternalSortParams) {
+			.elemsize = sizeof(Record),
+			.cmp_func = record_cmp,
+			.key_offset = offsetof(Record, key),
+			.key_width = sizeof(uint64_t),
+			.radix_flags = RADIX_UNSIGNED,
+			.memory_budget = 1 << 20,
+			.flags = EXTERNAL_SORT_DIRECT_IO
+	}, false);
+
+	ok &= test_to_func("streaming output, 4 MB budget", &(ExternalSortParams) {
+			.elemsize = sizeof(Record),
+			.cmp_func = record_cmp,
+			.memory_budget = 4 << 20
+	});
+
+	ok &= test_failed_write("read-only output, 256 KB budget", &(ExternalSortParams) {
+			.elemsize = sizeof(Record),
+			.cmp_func = record_cmp,
+			.memory_budget = 256 << 10
+	});
+
+	return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
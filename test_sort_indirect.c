@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Base.h"
+#include "Utils/Sort.h"
+
+/*
+ * argsort() and sort_indirect() against McIlroy's adversary ("A Killer Adversary
+ * for Quicksort"), which drives pdqsort into its heapsort fallback. The comparator
+ * must only ever see the records, and the order must be stable.
+ */
+
+typedef struct _Record
+{
+	int key;
+	size_t seq;
+	char payload[48];
+} Record;
+
+typedef struct
+{
+	const Record *base;
+	size_t len;
+	size_t *val;
+	size_t gas;
+	size_t nsolid;
+	size_t candidate;
+	size_t bad_calls;
+} Adversary;
+
+static Adversary adv;
+
+static bool adversary_index(const void *p, size_t *index)
+{
+	const char *c = p;
+	const char *base = (const char*) adv.base;
+
+	if (c < base || c >= base + adv.len * sizeof(Record) || (size_t) (c - base) % sizeof(Record) != 0)
+		return false;
+
+	*index = (size_t) (c - base) / sizeof(Record);
+
+	return true;
+}
+
+int adversary_cmp(const void *a, const void *b)
+{
+	size_t x, y;
+
+	if (!adversary_index(a, &x) || !adversary_index(b, &y))
+	{
+		adv.bad_calls++;
+		return 0;
+	}
+
+	if (adv.val[x] == adv.gas && adv.val[y] == adv.gas)
+	{
+		if (x == adv.candidate)
+			adv.val[x] = adv.nsolid++;
+		else
+			adv.val[y] = adv.nsolid++;
+	}
+
+	if (adv.val[x] == adv.gas)
+		adv.candidate = x;
+	else if (adv.val[y] == adv.gas)
+		adv.candidate = y;
+
+	return (adv.val[x] > adv.val[y]) - (adv.val[x] < adv.val[y]);
+}
+
+int record_cmp(const void *a, const void *b)
+{
+	const Record *ra = a;
+	const Record *rb = b;
+
+	return (ra->key > rb->key) - (ra->key < rb->key);
+}
+
+bool test_adversary(size_t len)
+{
+	Record *records = calloc(len, sizeof(Record));
+	size_t *val = malloc(len * sizeof(size_t));
+	exit_if_fail(records != NULL && val != NULL);
+
+	for (size_t i = 0; i < len; ++i)
+		val[i] = len;
+
+	adv = (Adversary) {
+		.base = records,
+		.len = len,
+		.val = val,
+		.gas = len,
+		.nsolid = 0,
+		.candidate = 0,
+		.bad_calls = 0
+	};
+
+	size_t *perm = argsort(records, len, sizeof(Record), adversary_cmp);
+	exit_if_fail(perm != NULL);
+
+	size_t misordered = 0;
+
+	for (size_t i = 1; i < len; ++i)
+	{
+		size_t a = perm[i - 1];
+		size_t b = perm[i];
+
+		if (val[a] > val[b] || (val[a] == val[b] && a > b))
+			misordered++;
+	}
+
+	printf("adversary, %lu records: %lu bad comparator calls, %lu misordered pairs\n",
+			len, adv.bad_calls, misordered);
+
+	bool res = (adv.bad_calls == 0 && misordered == 0);
+
+	free(perm);
+	free(val);
+	free(records);
+
+	return res;
+}
+
+bool test_stable(size_t len)
+{
+	Record *records = calloc(len, sizeof(Record));
+	exit_if_fail(records != NULL);
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		records[i].key = rand() % 16;
+		records[i].seq = i;
+	}
+
+	exit_if_fail(sort_indirect(records, len, sizeof(Record), record_cmp));
+
+	size_t misordered = 0;
+
+	for (size_t i = 1; i < len; ++i)
+	{
+		const Record *a = &records[i - 1];
+		const Record *b = &records[i];
+
+		if (a->key > b->key || (a->key == b->key && a->seq > b->seq))
+			misordered++;
+	}
+
+	printf("16 keys, %lu records: %lu misordered pairs\n", len, misordered);
+
+	free(records);
+
+	return misordered == 0;
+}
+
+/* Indices out of range or taken twice have to be refused before anything is moved */
+bool test_bad_permutation(size_t len)
+{
+	int *mass = malloc(len * sizeof(int));
+	int *copy = malloc(len * sizeof(int));
+	size_t *perm = malloc(len * sizeof(size_t));
+	exit_if_fail(mass != NULL && copy != NULL && perm != NULL);
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		mass[i] = (int) i;
+		perm[i] = len - 1 - i;
+	}
+
+	memcpy(copy, mass, len * sizeof(int));
+
+	/* An argsort() of a longer array */
+	perm[len / 2] = len + 5;
+	bool out_of_range = permute_apply(mass, len, sizeof(int), perm);
+
+	perm[len / 2] = perm[0];
+	bool repeated = permute_apply(mass, len, sizeof(int), perm);
+
+	bool untouched = (memcmp(mass, copy, len * sizeof(int)) == 0);
+
+	printf("bad permutations, %lu elements: %s\n", len,
+			(!out_of_range && !repeated && untouched) ? "refused" : "FAILED");
+
+	free(perm);
+	free(copy);
+	free(mass);
+
+	return !out_of_range && !repeated && untouched;
+}
+
+int main(int argc, char *argv[])
+{
+	bool ok = true;
+
+	srand(1);
+
+	ok &= test_adversary(1000);
+	ok &= test_adversary(100000);
+	ok &= test_adversary(1000000);
+	ok &= test_stable(100000);
+	ok &= test_bad_permutation(1000);
+
+	return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
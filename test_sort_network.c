@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+
+#include "Base.h"
+#include "Utils/Sort.h"
+
+/* Randomized differential test of the sorting networks against the scalar path */
+
+#define CASES 20000
+
+static const char *isa_names[] = {
+	"auto",
+	"scalar",
+	"sse4.1",
+	"avx2"
+};
+
+uint64_t rand64(void)
+{
+	return ((uint64_t) rand() << 62) ^ ((uint64_t) rand() << 31) ^ (uint64_t) rand();
+}
+
+/* Distributions: full range, duplicates, extremes */
+int64_t random_key(int dist, int64_t min, int64_t max)
+{
+	switch (dist)
+	{
+		case 0:
+			return (int64_t) rand64();
+		case 1:
+			return rand() % 8 - 4;
+		default:
+			switch (rand() % 4)
+			{
+				case 0: return min;
+				case 1: return max;
+				case 2: return 0;
+				default: return (int64_t) rand64();
+			}
+	}
+}
+
+float random_float(int dist)
+{
+	static const float specials[] = { 0.0f, -0.0f, INFINITY, -INFINITY, 1.0f, -1.0f, 3.4e38f, -3.4e38f, 1e-45f };
+
+	switch (dist)
+	{
+		case 0:
+			return (float) rand() / RAND_MAX * 2000.0f - 1000.0f;
+		case 1:
+			return (float) (rand() % 8 - 4);
+		default:
+			return specials[rand() % (sizeof(specials) / sizeof(specials[0]))];
+	}
+}
+
+int uint32_cmp(const void *a, const void *b)
+{
+	uint32_t ia = *(const uint32_t*) a;
+	uint32_t ib = *(const uint32_t*) b;
+
+	return (ia > ib) - (ia < ib);
+}
+
+/* The network may swap -0.0 and 0.0, so the values are compared, then the multisets of the bits */
+bool float_equal(const float *a, const float *b, size_t len)
+{
+	uint32_t bits_a[SORT_SMALL_MAX];
+	uint32_t bits_b[SORT_SMALL_MAX];
+
+	for (size_t i = 0; i < len; ++i)
+		if (!(a[i] == b[i] || (isnan(a[i]) && isnan(b[i]))))
+			return false;
+
+	memcpy(bits_a, a, len * sizeof(float));
+	memcpy(bits_b, b, len * sizeof(float));
+
+	qsort(bits_a, len, sizeof(uint32_t), uint32_cmp);
+	qsort(bits_b, len, sizeof(uint32_t), uint32_cmp);
+
+	return memcmp(bits_a, bits_b, len * sizeof(uint32_t)) == 0;
+}
+
+size_t test_isa(SortIsa isa)
+{
+	size_t failures = 0;
+
+	int32_t i32[SORT_SMALL_MAX], i32_ref[SORT_SMALL_MAX];
+	int64_t i64[SORT_SMALL_MAX], i64_ref[SORT_SMALL_MAX];
+	float f32[SORT_SMALL_MAX], f32_ref[SORT_SMALL_MAX];
+
+	for (size_t c = 0; c < CASES; ++c)
+	{
+		size_t len = (size_t) rand() % (SORT_SMALL_MAX + 1);
+		int dist = rand() % 3;
+
+		for (size_t i = 0; i < len; ++i)
+		{
+			i32[i] = (int32_t) random_key(dist, INT32_MIN, INT32_MAX);
+			i64[i] = random_key(dist, INT64_MIN, INT64_MAX);
+			f32[i] = random_float(dist);
+		}
+
+		/* NaNs send the keys to the scalar path, they are rare enough to test the networks */
+		if (len > 0 && rand() % 64 == 0)
+			f32[(size_t) rand() % len] = NAN;
+
+		memcpy(i32_ref, i32, sizeof(i32));
+		memcpy(i64_ref, i64, sizeof(i64));
+		memcpy(f32_ref, f32, sizeof(f32));
+
+		sort_small_set_isa(SORT_ISA_SCALAR);
+		sort_small_i32(i32_ref, len);
+		sort_small_i64(i64_ref, len);
+		sort_small_f32(f32_ref, len);
+
+		sort_small_set_isa(isa);
+		sort_small_i32(i32, len);
+		sort_small_i64(i64, len);
+		sort_small_f32(f32, len);
+
+		if (memcmp(i32, i32_ref, len * sizeof(int32_t)) != 0)
+		{
+			printf("%s: int32 mismatch, case %lu, len %lu\n", isa_names[isa], c, len);
+			++failures;
+		}
+
+		if (memcmp(i64, i64_ref, len * sizeof(int64_t)) != 0)
+		{
+			printf("%s: int64 mismatch, case %lu, len %lu\n", isa_names[isa], c, len);
+			++failures;
+		}
+
+		if (!float_equal(f32, f32_ref, len))
+		{
+			printf("%s: float mismatch, case %lu, len %lu\n", isa_names[isa], c, len);
+			++failures;
+		}
+	}
+
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned seed = (argc > 1) ? (unsigned) strtoul(argv[1], NULL, 10) : 1;
+	size_t failures = 0;
+
+	srand(seed);
+
+	for (SortIsa isa = SORT_ISA_SSE41; isa <= SORT_ISA_AVX2; ++isa)
+	{
+		if (!sort_small_set_isa(isa))
+		{
+			printf("%s: not supported by the CPU, skipped\n", isa_names[isa]);
+			continue;
+		}
+
+		size_t isa_failures = test_isa(isa);
+		printf("%s: %d cases, %lu failures\n", isa_names[isa], CASES, isa_failures);
+
+		failures += isa_failures;
+	}
+
+	sort_small_set_isa(SORT_ISA_AUTO);
+
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}